@@ -0,0 +1,145 @@
+#include <Arduino.h>
+#include "AsyncReply.h"
+
+AsyncReply::AsyncReply(RHReliableDatagram & manager, RHGenericDriver & driver, uint8_t retries, uint16_t timeout)
+    : _manager(manager), _driver(driver){
+    _retries = retries;
+    _timeout = timeout;
+    _on_failure = NULL;
+    _on_idle = NULL;
+    _on_send = NULL;
+    _on_ack = NULL;
+    _on_broadcast = NULL;
+    _state = REPLY_IDLE;
+    _sequence = 0;
+    _ack_head = 0;
+    _ack_count = 0;
+    _dropped = 0;
+    _retransmissions = 0;
+}
+
+bool AsyncReply::receive(uint8_t * buf, uint8_t * len, uint8_t * from, uint8_t * id, uint8_t * flags){
+    if(!_manager.available())
+        return false;
+
+    uint8_t to;
+    if(!_manager.recvfrom(buf, len, from, &to, id, flags))
+        return false;
+
+    if(*flags & RH_FLAGS_ACK){
+        if(_state >= REPLY_WAIT_TX && *from == _to && *id == _id){
+            // an ACK during REPLY_WAIT_TX is for an earlier copy
+            _state = REPLY_IDLE;
+            if(_on_ack)
+                _on_ack(_to, _tries, millis() - _sent_time);
+        }
+        return false;
+    }
+
+    if(to == RH_BROADCAST_ADDRESS && _on_broadcast){
+        _on_broadcast(*from, buf, *len);
+        return false;
+    }
+
+    if(to != _manager.thisAddress())
+        return false;
+
+    // a retransmission whose ACK is still queued needs no second one
+    for(uint8_t i = 0; i < _ack_count; i++){
+        uint8_t slot = (_ack_head + i) % ASYNC_REPLY_ACKS;
+        if(_ack_to[slot] == *from && _ack_id[slot] == *id)
+            return true;
+    }
+
+    if(_ack_count == ASYNC_REPLY_ACKS){
+        _dropped++;
+        return false;
+    }
+
+    uint8_t slot = (_ack_head + _ack_count) % ASYNC_REPLY_ACKS;
+    _ack_to[slot] = *from;
+    _ack_id[slot] = *id;
+    _ack_count++;
+    return true;
+}
+
+void AsyncReply::queue_reply(uint8_t to, uint8_t * data, uint8_t len){
+    if(_state != REPLY_IDLE && _on_failure)
+        _on_failure(_to);
+    _state = REPLY_SEND;
+    _to = to;
+    _id = ++_sequence;
+    _tries = 0;
+    _data = data;
+    _len = len;
+}
+
+void AsyncReply::broadcast(uint8_t * data, uint8_t len){
+    _manager.setHeaderId(++_sequence);
+    _manager.setHeaderFlags(RH_FLAGS_NONE, RH_FLAGS_ACK);
+    _manager.sendto(data, len, RH_BROADCAST_ADDRESS);
+}
+
+void AsyncReply::send_ack(){
+    uint8_t ack = '!';
+    _manager.setHeaderId(_ack_id[_ack_head]);
+    _manager.setHeaderFlags(RH_FLAGS_ACK);
+    _manager.sendto(&ack, sizeof(ack), _ack_to[_ack_head]);
+    _ack_head = (_ack_head + 1) % ASYNC_REPLY_ACKS;
+    _ack_count--;
+}
+
+void AsyncReply::service(){
+    bool transmitting = _driver.mode() == RHGenericDriver::RHModeTx;
+
+    if(_state == REPLY_WAIT_TX && !transmitting){
+        _sent_time = millis();
+        _state = REPLY_WAIT_ACK;
+    }
+
+    if(transmitting)
+        return;
+
+    if(_ack_count){
+        send_ack();
+        return;
+    }
+
+    if(_on_idle && _on_idle())
+        return;
+
+    switch(_state){
+        case REPLY_SEND:
+            _manager.setHeaderId(_id);
+#ifdef RH_FLAGS_RETRY
+            _manager.setHeaderFlags(_tries ? RH_FLAGS_RETRY : RH_FLAGS_NONE, RH_FLAGS_ACK | RH_FLAGS_RETRY);
+#else
+            _manager.setHeaderFlags(RH_FLAGS_NONE, RH_FLAGS_ACK);
+#endif
+            _manager.sendto(_data, _len, _to);
+            if(_on_send)
+                _wait = _on_send(_tries);
+            else
+                // same randomized backoff as RHReliableDatagram::sendtoWait()
+                _wait = _timeout + (_timeout * random(0, 256) / 256);
+            if(_tries++)
+                _retransmissions++;
+            _state = REPLY_WAIT_TX;
+            break;
+
+        case REPLY_WAIT_ACK:
+            if(millis() - _sent_time >= _wait){
+                if(_tries > _retries){
+                    _state = REPLY_IDLE;
+                    if(_on_failure)
+                        _on_failure(_to);
+                } else {
+                    _state = REPLY_SEND;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef AsyncReply_h
+#define AsyncReply_h
+
+// Non-blocking replies for an RHReliableDatagram base station.
+//
+// recvfromAck() and sendtoWait() block the loop while RH_ASK transmits and
+// while the other end's ACK is awaited, which at 480 bps is most of a
+// second per message. Here the ACKs we owe and our own reply go out through
+// a state machine stepped by service() on every loop pass, so receiving and
+// the display keep running.
+//
+// Same wire format as RHReliableDatagram: data frames carry a sequence id
+// with RH_FLAGS_ACK clear, ACKs echo the id with RH_FLAGS_ACK set. Owed
+// ACKs are queued and always sent before anything else.
+//
+// A client uses the same pipeline for its uplink: its reading goes out
+// with queue_reply() to the server, and the server's reply is received
+// and ACKed like any data frame. on_send() lets it set the ACK wait of each
+// try (e.g. from lib/LinkAdapt) and on_ack() reports the round trip.
+
+#include <Arduino.h>
+#include <RHReliableDatagram.h>
+
+#ifndef ASYNC_REPLY_ACKS
+#define ASYNC_REPLY_ACKS 2      // ACKs that can be owed at once
+#endif
+
+typedef enum {
+    REPLY_IDLE,
+    REPLY_SEND,       // waiting for the transmitter to be free
+    REPLY_WAIT_TX,    // RH_ASK is sending the reply
+    REPLY_WAIT_ACK    // sent, waiting for the client's ACK or a timeout
+} reply_state_t;
+
+// Called with the client address when a reply is given up on, either after
+// the last retry or because a newer reply to send replaced it
+typedef void (*reply_failure_t)(uint8_t to);
+
+// Called when the transmitter is free and no ACK is owed; returns true if
+// it started a transmission (e.g. with broadcast()), which goes before the
+// reply
+typedef bool (*reply_idle_t)();
+
+// Called as each copy of the reply goes out, with the tries before it;
+// returns the ms to wait for its ACK
+typedef uint16_t (*reply_send_t)(uint8_t tries);
+
+// Called when the reply is ACKed, with the tries it took and the ms since
+// the last copy went out
+typedef void (*reply_ack_t)(uint8_t to, uint8_t tries, unsigned long round_trip);
+
+// Called for a data frame sent to RH_BROADCAST_ADDRESS, e.g. a beacon
+typedef void (*reply_broadcast_t)(uint8_t from, uint8_t * buf, uint8_t len);
+
+class AsyncReply
+{
+public:
+    AsyncReply(RHReliableDatagram & manager, RHGenericDriver & driver, uint8_t retries, uint16_t timeout);
+
+    void on_failure(reply_failure_t handler){ _on_failure = handler; }
+    void on_idle(reply_idle_t handler){ _on_idle = handler; }
+    // without one, each try waits RHReliableDatagram's randomized timeout
+    void on_send(reply_send_t handler){ _on_send = handler; }
+    void on_ack(reply_ack_t handler){ _on_ack = handler; }
+    void on_broadcast(reply_broadcast_t handler){ _on_broadcast = handler; }
+
+    // resends allowed, checked each time an ACK wait runs out
+    void set_retries(uint8_t retries){ _retries = retries; }
+
+    // recvfromAck() replacement. Hands ACK frames to the reply, queues our
+    // own ACK for a data frame addressed to us and returns true for it. A
+    // frame that arrives while the ACK queue is full is dropped unACKed,
+    // so the client's retry brings it back.
+    bool receive(uint8_t * buf, uint8_t * len, uint8_t * from, uint8_t * id, uint8_t * flags);
+
+    // Reply to a client; a new reply supersedes one still being retried
+    void queue_reply(uint8_t to, uint8_t * data, uint8_t len);
+
+    // Unacknowledged send to every client, with a fresh header id so their
+    // duplicate filter does not drop it
+    void broadcast(uint8_t * data, uint8_t len);
+
+    // Step the pipeline; call on every loop pass
+    void service();
+
+    reply_state_t state(){ return _state; }
+    uint8_t tries(){ return _tries; }
+    uint8_t acks_owed(){ return _ack_count; }
+    uint16_t dropped(){ return _dropped; }
+    // replies sent again after no ACK came, like RHReliableDatagram's count
+    uint32_t retransmissions(){ return _retransmissions; }
+
+private:
+    void send_ack();
+
+    RHReliableDatagram & _manager;
+    RHGenericDriver & _driver;
+    uint8_t _retries;
+    uint16_t _timeout;
+    reply_failure_t _on_failure;
+    reply_idle_t _on_idle;
+    reply_send_t _on_send;
+    reply_ack_t _on_ack;
+    reply_broadcast_t _on_broadcast;
+
+    reply_state_t _state;
+    uint8_t _to;
+    uint8_t _id;
+    uint8_t _tries;
+    uint8_t * _data;
+    uint8_t _len;
+    unsigned long _sent_time;
+    unsigned long _wait;
+    uint8_t _sequence;
+
+    uint8_t _ack_to[ASYNC_REPLY_ACKS];
+    uint8_t _ack_id[ASYNC_REPLY_ACKS];
+    uint8_t _ack_head;
+    uint8_t _ack_count;
+    uint16_t _dropped;            // frames refused because the ACK queue was full
+    uint32_t _retransmissions;
+};
+#endif
@@ -0,0 +1,172 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include "AuthCode.h"
+
+static inline uint32_t rotl(uint32_t x, uint8_t b){
+    return (x << b) | (x >> (32 - b));
+}
+
+// multiply by x in GF(2^128), without a branch on the key
+static void times_two(uint32_t * out, const uint32_t * in){
+    uint32_t carry = -(in[3] >> 31) & 0x87;
+    out[3] = (in[3] << 1) | (in[2] >> 31);
+    out[2] = (in[2] << 1) | (in[1] >> 31);
+    out[1] = (in[1] << 1) | (in[0] >> 31);
+    out[0] = (in[0] << 1) ^ carry;
+}
+
+static uint32_t get_u32(const uint8_t * p){
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u32(uint8_t * p, uint32_t value){
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+AuthCode::AuthCode(uint16_t eeprom_start, uint32_t window){
+    _eeprom_start = eeprom_start;
+    _window = window;
+    _counter = 0;
+    _code_counter = 0;
+    _rounds_left = 0;
+    _busy = false;
+    _latest_copy = 0;
+    _write_copy = 0;
+    _write_byte = AUTH_CODE_COPY_SIZE;
+}
+
+uint8_t AuthCode::check_byte(const uint8_t * bytes){
+    // erased EEPROM (all 0xFF) does not pass
+    uint8_t sum = 0x5A;
+    for(uint8_t i = 0; i < AUTH_CODE_COPY_SIZE - 1; i++)
+        sum += bytes[i];
+    return sum;
+}
+
+bool AuthCode::read_copy(uint8_t copy, uint32_t & counter){
+    uint8_t bytes[AUTH_CODE_COPY_SIZE];
+    eeprom_read_block(bytes, (const void *)(_eeprom_start + copy * AUTH_CODE_COPY_SIZE), sizeof(bytes));
+    if(bytes[AUTH_CODE_COPY_SIZE - 1] != check_byte(bytes))
+        return false;
+    counter = get_u32(bytes);
+    return true;
+}
+
+void AuthCode::begin(const uint8_t * key){
+    for(uint8_t i = 0; i < 4; i++)
+        _key[i] = get_u32(key + 4 * i);
+    uint32_t key1[4];
+    times_two(key1, _key);
+    times_two(_key2, key1);
+
+    uint32_t counter0, counter1;
+    bool valid0 = read_copy(0, counter0);
+    bool valid1 = read_copy(1, counter1);
+    _counter = 0;
+    _latest_copy = 1;
+    if(valid0){
+        _counter = counter0;
+        _latest_copy = 0;
+    }
+    if(valid1 && (!valid0 || (int32_t)(counter1 - counter0) > 0)){
+        _counter = counter1;
+        _latest_copy = 1;
+    }
+}
+
+// The counter fits in one block, padded with 0x01, so the padded-block
+// subkey goes in before and after the permutation
+void AuthCode::start_mac(uint32_t counter){
+    _v[0] = _key[0] ^ _key2[0] ^ counter;
+    _v[1] = _key[1] ^ _key2[1] ^ 0x01;
+    _v[2] = _key[2] ^ _key2[2];
+    _v[3] = _key[3] ^ _key2[3];
+    _rounds_left = AUTH_CODE_ROUNDS;
+}
+
+void AuthCode::run_rounds(uint8_t rounds){
+    if(rounds > _rounds_left)
+        rounds = _rounds_left;
+    _rounds_left -= rounds;
+
+    uint32_t v0 = _v[0], v1 = _v[1], v2 = _v[2], v3 = _v[3];
+    while(rounds--){
+        v0 += v1; v1 = rotl(v1, 5); v1 ^= v0; v0 = rotl(v0, 16);
+        v2 += v3; v3 = rotl(v3, 8); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 13); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 7); v1 ^= v2; v2 = rotl(v2, 16);
+    }
+    _v[0] = v0; _v[1] = v1; _v[2] = v2; _v[3] = v3;
+}
+
+void AuthCode::finish_mac(){
+    _v[0] ^= _key2[0];
+}
+
+auth_result_t AuthCode::verify_begin(const uint8_t * code){
+    _busy = false;
+    _code_counter = get_u32(code);
+
+    // the counter is sent in the clear, so checking it first gives nothing away
+    uint32_t ahead = _code_counter - _counter;
+    if(ahead == 0 || ahead >= 0x80000000UL)
+        return AUTH_REPLAYED;
+    if(ahead > _window)
+        return AUTH_OUT_OF_WINDOW;
+
+    memcpy(_tag, code + 4, AUTH_CODE_TAG_SIZE);
+    start_mac(_code_counter);
+    _busy = true;
+    return AUTH_BUSY;
+}
+
+auth_result_t AuthCode::verify_step(){
+    if(!_busy)
+        return AUTH_IDLE;
+
+    run_rounds(AUTH_CODE_ROUNDS_PER_STEP);
+    if(_rounds_left > 0)
+        return AUTH_BUSY;
+
+    _busy = false;
+    finish_mac();
+    uint8_t expected[AUTH_CODE_TAG_SIZE];
+    put_u32(expected, _v[0]);
+    uint8_t diff = 0;
+    for(uint8_t i = 0; i < AUTH_CODE_TAG_SIZE; i++)
+        diff |= expected[i] ^ _tag[i];
+    if(diff != 0)
+        return AUTH_BAD_TAG;
+
+    // accepted in RAM at once, so the same code word can't be replayed
+    // while the EEPROM copy is still being written
+    _counter = _code_counter;
+    put_u32(_write_data, _counter);
+    _write_data[AUTH_CODE_COPY_SIZE - 1] = check_byte(_write_data);
+    // a write still in progress restarts on the same (older) copy
+    if(_write_byte == AUTH_CODE_COPY_SIZE)
+        _write_copy = _latest_copy ^ 1;
+    _write_byte = 0;
+    return AUTH_OK;
+}
+
+void AuthCode::service(){
+    if(_write_byte == AUTH_CODE_COPY_SIZE || !eeprom_is_ready())
+        return;
+
+    uint16_t address = _eeprom_start + _write_copy * AUTH_CODE_COPY_SIZE + _write_byte;
+    eeprom_update_byte((uint8_t *)address, _write_data[_write_byte]);
+    if(++_write_byte == AUTH_CODE_COPY_SIZE)
+        _latest_copy = _write_copy;
+}
+
+void AuthCode::sign(uint32_t counter, uint8_t * code){
+    start_mac(counter);
+    run_rounds(AUTH_CODE_ROUNDS);
+    finish_mac();
+    put_u32(code, counter);
+    put_u32(code + 4, _v[0]);
+}
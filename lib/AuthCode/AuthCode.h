@@ -0,0 +1,90 @@
+#ifndef AuthCode_h
+#define AuthCode_h
+
+// Counter-based authenticated code words for the garage door receiver.
+//
+// A code word is a 32-bit counter followed by a 32-bit tag, both little
+// endian. The tag is the Chaskey-12 MAC of the counter, truncated to four
+// bytes. Chaskey only adds, rotates and xors four 32-bit words, with no
+// table lookups or data-dependent branches, so every code word takes the
+// same time to check. The tag is compared without an early exit.
+//
+// A full MAC is too long for one loop pass next to the 100 us input
+// sampling, so verify_step() runs AUTH_CODE_ROUNDS_PER_STEP rounds per call.
+//
+// A counter is only accepted if it is ahead of the last accepted one by no
+// more than the window. That allows for presses made out of range and makes
+// every code word single use. The last accepted counter is kept in two
+// EEPROM copies, written alternately one byte per service() call, so a
+// reset part way through a write still leaves the previous counter.
+
+#include <Arduino.h>
+
+#define AUTH_CODE_KEY_SIZE 16
+#define AUTH_CODE_TAG_SIZE 4
+#define AUTH_CODE_SIZE 8                // counter, then tag
+#define AUTH_CODE_ROUNDS 12
+#ifndef AUTH_CODE_ROUNDS_PER_STEP
+#define AUTH_CODE_ROUNDS_PER_STEP 2
+#endif
+#define AUTH_CODE_COPY_SIZE 5           // counter and a check byte
+#define AUTH_CODE_EEPROM_SIZE (2 * AUTH_CODE_COPY_SIZE)
+
+typedef enum {
+    AUTH_IDLE,
+    AUTH_BUSY,              // MAC rounds still to run
+    AUTH_OK,                // tag matched, counter accepted
+    AUTH_BAD_TAG,
+    AUTH_REPLAYED,          // counter not ahead of the last accepted one
+    AUTH_OUT_OF_WINDOW      // counter too far ahead
+} auth_result_t;
+
+class AuthCode
+{
+public:
+    AuthCode(uint16_t eeprom_start, uint32_t window);
+
+    // derive the subkey and load the last accepted counter from EEPROM
+    void begin(const uint8_t * key);
+
+    // Checks the counter window and starts the MAC. Returns AUTH_BUSY, or a
+    // rejection straight away if the counter is outside the window.
+    auth_result_t verify_begin(const uint8_t * code);
+
+    // AUTH_BUSY until the tag has been compared
+    auth_result_t verify_step();
+
+    // writes at most one byte of a newly accepted counter, never waits on EEPROM
+    void service();
+
+    uint32_t counter(){ return _counter; }
+    uint32_t code_counter(){ return _code_counter; }
+    bool writing(){ return _write_byte < AUTH_CODE_COPY_SIZE; }
+
+    // the whole MAC in one call, for building test code words
+    void sign(uint32_t counter, uint8_t * code);
+
+private:
+    void start_mac(uint32_t counter);
+    void run_rounds(uint8_t rounds);
+    void finish_mac();
+    bool read_copy(uint8_t copy, uint32_t & counter);
+    static uint8_t check_byte(const uint8_t * bytes);
+
+    uint32_t _key[4];
+    uint32_t _key2[4];      // subkey for a padded last block
+    uint32_t _v[4];
+    uint32_t _code_counter;
+    uint8_t _tag[AUTH_CODE_TAG_SIZE];
+    uint8_t _rounds_left;
+    bool _busy;
+
+    uint32_t _counter;      // last accepted
+    uint32_t _window;
+    uint16_t _eeprom_start;
+    uint8_t _latest_copy;   // copy holding _counter once written
+    uint8_t _write_copy;
+    uint8_t _write_byte;    // progress through _write_data, AUTH_CODE_COPY_SIZE when idle
+    uint8_t _write_data[AUTH_CODE_COPY_SIZE];
+};
+#endif
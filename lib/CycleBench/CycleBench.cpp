@@ -0,0 +1,109 @@
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include "CycleBench.h"
+
+static volatile uint16_t _timer1_overflows = 0;
+
+ISR(TIMER1_OVF_vect){
+    _timer1_overflows++;
+}
+
+unsigned long CycleBench::_overhead = 0;
+
+CycleBench::CycleBench(const char * name, unsigned long budget){
+    _name = name;
+    _budget = budget;
+    reset();
+}
+
+// take over Timer1 as a free-running cycle counter, then measure what an
+// empty begin()/end() pair costs so it can be taken off every sample
+void CycleBench::init(){
+    noInterrupts();
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+    TCNT1 = 0;
+    TIFR1 = _BV(TOV1);
+    TIMSK1 = _BV(TOIE1);
+    _timer1_overflows = 0;
+    interrupts();
+
+    CycleBench calibrate("", 0);
+    for(byte i = 0; i < 8; i++){
+        calibrate.begin();
+        calibrate.end();
+    }
+    _overhead = calibrate._min;
+}
+
+// same pattern as micros(): an overflow pending while interrupts are off
+// has not been counted yet if the low word already wrapped
+unsigned long CycleBench::now(){
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t low = TCNT1;
+    uint16_t high = _timer1_overflows;
+    if((TIFR1 & _BV(TOV1)) && low < 0x8000)
+        high++;
+    SREG = oldSREG;
+    return ((unsigned long)high << 16) | low;
+}
+
+// sleeping with interrupts off ends a simavr run cleanly
+void CycleBench::halt(){
+    Serial.println(F(CYCLE_BENCH_DONE_MARKER));
+    Serial.flush();
+    cli();
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sleep_cpu();
+    while(true);
+}
+
+void CycleBench::begin(){
+    _start = now();
+}
+
+void CycleBench::end(){
+    unsigned long cycles = now() - _start;
+    cycles = cycles > _overhead ? cycles - _overhead : 0;
+    _count++;
+    _total += cycles;
+    if(cycles < _min)
+        _min = cycles;
+    if(cycles > _max)
+        _max = cycles;
+}
+
+void CycleBench::reset(){
+    _count = 0;
+    _min = (unsigned long)-1L;
+    _max = 0;
+    _total = 0;
+}
+
+bool CycleBench::over_budget(){
+    return _budget && _max > _budget;
+}
+
+bool CycleBench::report(Print & out){
+    out.print(F("BENCH "));
+    out.print(_name);
+    out.print(F(" n="));
+    out.print(_count);
+    out.print(F(" min="));
+    out.print(_count ? _min : 0);
+    out.print(F(" avg="));
+    out.print(_count ? (unsigned long)(_total / _count) : 0);
+    out.print(F(" max="));
+    out.print(_max);
+    out.print(F(" budget="));
+    out.print(_budget);
+    if(over_budget()){
+        out.println(F(" FAIL"));
+        return false;
+    }
+    out.println(F(" OK"));
+    return true;
+}
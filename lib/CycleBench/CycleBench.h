@@ -0,0 +1,51 @@
+#ifndef CycleBench_h
+#define CycleBench_h
+
+// Cycle-accurate timing markers for the 16 MHz ATmega328P.
+//
+// Timer1 runs free at clk/1, so one timer tick is exactly one CPU cycle.
+// An overflow interrupt extends it to 32 bits. The same counts come out
+// on real hardware and under simavr, which models the timer exactly.
+//
+// Timer1 is shared with RH_ASK, Servo and analogWrite() on pins 9/10, so
+// only enable the bench in builds that leave Timer1 alone.
+
+#include <Arduino.h>
+
+// printed on the line after the last result so a runner knows the report is complete
+#define CYCLE_BENCH_DONE_MARKER "BENCH DONE"
+
+class CycleBench
+{
+public:
+    // budget is a hard ceiling for the worst-case count, 0 = report only
+    CycleBench(const char * name, unsigned long budget = 0);
+
+    static void init();
+    static unsigned long now();
+    static void halt();
+
+    void begin();
+    void end();
+    void reset();
+
+    // one "BENCH <name> n=.. min=.. avg=.. max=.. budget=.. OK|FAIL" line
+    bool report(Print & out);
+    bool over_budget();
+
+    const char * name(){ return _name; }
+    unsigned long count(){ return _count; }
+    unsigned long max_cycles(){ return _max; }
+
+private:
+    const char * _name;
+    unsigned long _budget;
+    unsigned long _start;
+    unsigned long _count;
+    unsigned long _min;
+    unsigned long _max;
+    unsigned long long _total;
+
+    static unsigned long _overhead;
+};
+#endif
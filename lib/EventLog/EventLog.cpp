@@ -0,0 +1,162 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include "EventLog.h"
+
+EventLog::EventLog(uint16_t eeprom_start, uint16_t eeprom_size){
+    _eeprom_start = eeprom_start;
+    _slots = eeprom_size / SLOT_SIZE;
+    // sequence numbers run 0..0xFE, more slots than that would make them ambiguous
+    if(_slots > 0xFE)
+        _slots = 0xFE;
+    _next_slot = 0;
+    _next_seq = 0;
+    _head = 0;
+    _count = 0;
+    _flush_byte = 0;
+    _dropped = 0;
+    _last_ms = 0;
+}
+
+void EventLog::read_slot(uint16_t slot, event_record_t & record, uint8_t & seq){
+    uint16_t address = slot_address(slot);
+    eeprom_read_block(&record, (const void *)address, sizeof(record));
+    seq = eeprom_read_byte((const uint8_t *)(address + sizeof(record)));
+}
+
+// The newest slot is the last one whose successor does not carry the next
+// sequence number. Erased slots (0xFF) never match since sequence numbers
+// skip 0xFF.
+void EventLog::begin(){
+    event_record_t record;
+    uint8_t seq, first_seq, last_seq;
+    read_slot(0, record, first_seq);
+
+    _next_slot = 0;
+    _next_seq = 0;
+    if(first_seq != EVENT_LOG_EMPTY){
+        last_seq = first_seq;
+        uint16_t slot = 1;
+        for(; slot < _slots; slot++){
+            read_slot(slot, record, seq);
+            if(seq != next_seq(last_seq))
+                break;
+            last_seq = seq;
+        }
+        _next_slot = slot % _slots;
+        _next_seq = next_seq(last_seq);
+    }
+
+    // the boot record is time 0, the same base as EVENT_LOG_TIME anchors
+    _last_ms = 0;
+    push(EVENT_LOG_BOOT, 0, 0);
+}
+
+bool EventLog::push(uint8_t type, uint16_t delta, uint16_t value){
+    if(_count >= EVENT_LOG_RAM_ENTRIES){
+        _dropped++;
+        return false;
+    }
+    event_record_t & record = _queue[(_head + _count) % EVENT_LOG_RAM_ENTRIES];
+    record.type = type;
+    record.delta = delta;
+    record.value = value;
+    _count++;
+    return true;
+}
+
+// shifts only, no division, since this runs on the pulse path.
+// _last_ms only moves by what a queued record encodes: a dropped record
+// leaves its gap to the next one, and the part of a coarse delta below
+// 1024 ms is carried instead of lost
+void EventLog::add(uint8_t type, uint16_t value){
+    unsigned long now = millis();
+    unsigned long delta = now - _last_ms;
+
+    if(delta < EVENT_LOG_DELTA_COARSE){
+        if(push(type, delta, value))
+            _last_ms = now;
+        return;
+    }
+
+    unsigned long units = delta >> EVENT_LOG_COARSE_SHIFT;
+    if(units < EVENT_LOG_DELTA_COARSE){
+        if(push(type, EVENT_LOG_DELTA_COARSE | units, value))
+            _last_ms += units << EVENT_LOG_COARSE_SHIFT;
+        return;
+    }
+
+    // too long a gap for a delta, anchor with the time since boot; the
+    // record after the anchor holds the ms it leaves out
+    if(_count > EVENT_LOG_RAM_ENTRIES - 2){
+        _dropped++;
+        return;
+    }
+    unsigned long coarse_now = now >> EVENT_LOG_COARSE_SHIFT;
+    push(EVENT_LOG_TIME, coarse_now >> 16, coarse_now);
+    push(type, now & ((1 << EVENT_LOG_COARSE_SHIFT) - 1), value);
+    _last_ms = now;
+}
+
+void EventLog::flush_step(){
+    if(_count == 0 || !eeprom_is_ready())
+        return;
+
+    const uint8_t * record = (const uint8_t *)&_queue[_head];
+    uint16_t address = slot_address(_next_slot) + _flush_byte;
+
+    // the sequence byte goes last, so a slot cut short by a reset keeps its
+    // old sequence number and is not mistaken for the newest record
+    if(_flush_byte < sizeof(event_record_t)){
+        eeprom_update_byte((uint8_t *)address, record[_flush_byte]);
+        _flush_byte++;
+        return;
+    }
+
+    eeprom_update_byte((uint8_t *)address, _next_seq);
+    _next_seq = next_seq(_next_seq);
+    _next_slot = (_next_slot + 1) % _slots;
+    _flush_byte = 0;
+    _head = (_head + 1) % EVENT_LOG_RAM_ENTRIES;
+    _count--;
+}
+
+static unsigned long advance_time(unsigned long time_ms, const event_record_t & record){
+    if(record.type == EVENT_LOG_BOOT)
+        return 0;
+    if(record.type == EVENT_LOG_TIME)
+        return (((unsigned long)record.delta << 16) | record.value) << EVENT_LOG_COARSE_SHIFT;
+    if(record.delta & EVENT_LOG_DELTA_COARSE)
+        return time_ms + ((unsigned long)(record.delta & ~EVENT_LOG_DELTA_COARSE) << EVENT_LOG_COARSE_SHIFT);
+    return time_ms + record.delta;
+}
+
+void EventLog::dump(void (*callback)(const event_record_t & record, unsigned long time_ms)){
+    event_record_t record;
+    uint8_t seq;
+    unsigned long time_ms = 0;
+
+    // oldest slot is the one after the newest, unless the ring has not wrapped yet
+    uint16_t slot = _next_slot;
+    read_slot(slot, record, seq);
+    if(seq == EVENT_LOG_EMPTY)
+        slot = 0;
+
+    for(uint16_t i = 0; i < _slots; i++, slot = (slot + 1) % _slots){
+        if(slot == _next_slot && i > 0)
+            break;
+        read_slot(slot, record, seq);
+        if(seq == EVENT_LOG_EMPTY)
+            continue;
+        // a slot whose write was interrupted by the flush in progress
+        if(slot == _next_slot && _flush_byte > 0)
+            continue;
+        time_ms = advance_time(time_ms, record);
+        callback(record, time_ms);
+    }
+
+    for(uint8_t i = 0; i < _count; i++){
+        const event_record_t & queued = _queue[(_head + i) % EVENT_LOG_RAM_ENTRIES];
+        time_ms = advance_time(time_ms, queued);
+        callback(queued, time_ms);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef EventLog_h
+#define EventLog_h
+
+// Black-box event recorder: a small RAM queue drained into a ring of
+// EEPROM slots.
+//
+// add() only stores five bytes in RAM, so it is cheap enough for the pulse
+// path. flush_step() writes at most one EEPROM byte per call, and only
+// when the previous write has finished, so it never busy-waits the 3.4 ms
+// an EEPROM write takes.
+//
+// Each EEPROM slot is a record followed by a sequence byte. Slots are
+// written round robin so they all wear evenly, and the newest slot is found
+// at boot as the place where the sequence numbers stop counting up, so no
+// separate head pointer has to be rewritten on every flush.
+
+#include <Arduino.h>
+
+#define EVENT_LOG_RAM_ENTRIES 16
+
+// delta field: below this, milliseconds since the previous record;
+// with the flag set, the low 15 bits are units of 1024 ms (up to 9.3 hours)
+#define EVENT_LOG_DELTA_COARSE 0x8000
+#define EVENT_LOG_COARSE_SHIFT 10
+
+// record types 0xF0 and up belong to the log itself
+#define EVENT_LOG_BOOT 0xF0     // first record after every reset
+#define EVENT_LOG_TIME 0xF1     // delta:value = ms since boot >> 10, after a long quiet gap
+#define EVENT_LOG_EMPTY 0xFF    // erased EEPROM
+
+typedef struct {
+    uint8_t type;
+    uint16_t delta;
+    uint16_t value;
+} __attribute__((packed)) event_record_t;
+
+class EventLog
+{
+public:
+    EventLog(uint16_t eeprom_start, uint16_t eeprom_size);
+
+    // find the newest slot and log a boot record
+    void begin();
+
+    void add(uint8_t type, uint16_t value);
+    void flush_step();
+
+    uint8_t pending(){ return _count; }
+    uint16_t dropped(){ return _dropped; }
+    uint16_t slots(){ return _slots; }
+
+    // oldest first, EEPROM then anything still queued in RAM;
+    // time_ms is rebuilt from the deltas and restarts at each boot record
+    void dump(void (*callback)(const event_record_t & record, unsigned long time_ms));
+
+private:
+    bool push(uint8_t type, uint16_t delta, uint16_t value);
+    void read_slot(uint16_t slot, event_record_t & record, uint8_t & seq);
+    uint16_t slot_address(uint16_t slot){ return _eeprom_start + slot * SLOT_SIZE; }
+    static uint8_t next_seq(uint8_t seq){ return seq >= 0xFE ? 0 : seq + 1; }
+
+    static const uint8_t SLOT_SIZE = sizeof(event_record_t) + 1;
+
+    uint16_t _eeprom_start;
+    uint16_t _slots;
+    uint16_t _next_slot;    // slot the next flushed record goes to
+    uint8_t _next_seq;
+
+    event_record_t _queue[EVENT_LOG_RAM_ENTRIES];
+    uint8_t _head;          // oldest queued record
+    uint8_t _count;
+    uint8_t _flush_byte;    // progress through the slot being written
+    uint16_t _dropped;
+    unsigned long _last_ms;
+};
+#endif
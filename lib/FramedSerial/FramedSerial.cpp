@@ -0,0 +1,119 @@
+#include <Arduino.h>
+#include "FramedSerial.h"
+
+FramedSerial::FramedSerial(Stream & stream) : _stream(stream){
+    _received = 0;
+    _length = 0;
+    _overflow = false;
+    _bad_frames = 0;
+}
+
+uint16_t FramedSerial::crc16(const byte * data, byte length, uint16_t crc){
+    while(length--){
+        crc ^= (uint16_t)*data++ << 8;
+        for(byte i = 0; i < 8; i++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+byte * FramedSerial::put_u16(byte * out, uint16_t value){
+    *out++ = value;
+    *out++ = value >> 8;
+    return out;
+}
+
+byte * FramedSerial::put_u32(byte * out, uint32_t value){
+    out = put_u16(out, value);
+    return put_u16(out, value >> 16);
+}
+
+uint32_t FramedSerial::get_u32(const byte * in){
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// only reads what is already buffered, so it never blocks the caller
+bool FramedSerial::poll(){
+    while(_stream.available()){
+        byte c = _stream.read();
+        if(c != 0){
+            if(_received < FRAMED_SERIAL_MAX_ENCODED)
+                _encoded[_received++] = c;
+            else
+                _overflow = true;
+            continue;
+        }
+
+        // delimiter: back-to-back delimiters are just an empty frame, skip them
+        bool good = false;
+        if(_received > 0){
+            good = !_overflow && decode();
+            if(!good)
+                _bad_frames++;
+        }
+        _received = 0;
+        _overflow = false;
+        if(good)
+            return true;
+    }
+    return false;
+}
+
+bool FramedSerial::decode(){
+    byte out = 0;
+    byte in = 0;
+    while(in < _received){
+        byte code = _encoded[in++];
+        for(byte i = 1; i < code; i++){
+            if(in >= _received || out >= sizeof(_payload))
+                return false;
+            _payload[out++] = _encoded[in++];
+        }
+        if(code < 0xFF && in < _received){
+            if(out >= sizeof(_payload))
+                return false;
+            _payload[out++] = 0;
+        }
+    }
+
+    // at least type + seq + crc
+    if(out < 4)
+        return false;
+    _length = out - 2;
+    uint16_t crc = _payload[_length] | (_payload[_length + 1] << 8);
+    return crc16(_payload, _length) == crc;
+}
+
+bool FramedSerial::send(byte type, byte seq, const byte * body, byte length){
+    if(length > FRAMED_SERIAL_MAX_PAYLOAD - 2)
+        return false;
+
+    byte header[2] = { type, seq };
+    uint16_t crc = crc16(header, 2);
+    crc = crc16(body, length, crc);
+    byte trailer[2] = { (byte)crc, (byte)(crc >> 8) };
+
+    // COBS encode header + body + trailer straight into the output buffer
+    byte encoded[FRAMED_SERIAL_MAX_ENCODED];
+    byte code_pos = 0;
+    byte out = 1;
+    byte code = 1;
+    byte total = length + 4;
+    for(byte i = 0; i < total; i++){
+        byte c = i < 2 ? header[i] : i < length + 2 ? body[i - 2] : trailer[i - length - 2];
+        if(c == 0){
+            encoded[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        } else {
+            encoded[out++] = c;
+            code++;
+        }
+    }
+    encoded[code_pos] = code;
+
+    _stream.write((byte)0);
+    _stream.write(encoded, out);
+    _stream.write((byte)0);
+    return true;
+}
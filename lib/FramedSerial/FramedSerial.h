@@ -0,0 +1,55 @@
+#ifndef FramedSerial_h
+#define FramedSerial_h
+
+// COBS framed, CRC checked binary messages over a Stream.
+//
+// On the wire every frame is  00 <COBS(payload + crc16)> 00
+// The leading delimiter as well as the trailing one means any text that
+// shares the port (or line noise) only ever costs the receiver one bad
+// frame, never the frame after it.
+//
+// payload = <type> <seq> <body...>, crc16 is CRC-16/CCITT-FALSE over the
+// payload, little endian.
+
+#include <Arduino.h>
+
+#define FRAMED_SERIAL_MAX_PAYLOAD 48
+// payload + crc, plus COBS overhead (one code byte per 254 data bytes + 1)
+#define FRAMED_SERIAL_MAX_ENCODED (FRAMED_SERIAL_MAX_PAYLOAD + 2 + 2)
+
+class FramedSerial
+{
+public:
+    FramedSerial(Stream & stream);
+
+    // feed available bytes through the decoder, true when a good frame is ready
+    bool poll();
+
+    byte type(){ return _payload[0]; }
+    byte seq(){ return _payload[1]; }
+    byte * body(){ return _payload + 2; }
+    byte body_length(){ return _length - 2; }
+
+    bool send(byte type, byte seq, const byte * body, byte length);
+
+    unsigned int bad_frames(){ return _bad_frames; }
+
+    static uint16_t crc16(const byte * data, byte length, uint16_t crc = 0xFFFF);
+
+    // helpers for packing little endian values into frame bodies
+    static byte * put_u16(byte * out, uint16_t value);
+    static byte * put_u32(byte * out, uint32_t value);
+    static uint32_t get_u32(const byte * in);
+
+private:
+    bool decode();
+
+    Stream & _stream;
+    byte _encoded[FRAMED_SERIAL_MAX_ENCODED];
+    byte _payload[FRAMED_SERIAL_MAX_PAYLOAD + 2];
+    byte _received;
+    byte _length;
+    bool _overflow;
+    unsigned int _bad_frames;
+};
+#endif
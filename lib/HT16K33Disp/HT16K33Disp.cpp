@@ -17,6 +17,7 @@ void HT16K33Disp::set_address(byte address, byte num_displays){
 // point to an array of bytes specifying brightness levels per display
 void HT16K33Disp::init(byte *brightLevels){
     for(byte i = 0; i < _num_displays; i++){
+#ifndef HT16K33Disp_NO_I2C
         Wire.beginTransmission(_address + i);
         Wire.write(0x21);               //normal operation mode
         Wire.endTransmission(false);
@@ -26,6 +27,7 @@ void HT16K33Disp::init(byte *brightLevels){
         Wire.beginTransmission(_address + i);
         Wire.write(0x81);               //display ON, blinking OFF
         Wire.endTransmission();
+#endif
         clear();
     }
 }
@@ -33,11 +35,13 @@ void HT16K33Disp::init(byte *brightLevels){
 void HT16K33Disp::write(byte digit, unsigned int data){
     byte display = digit / NUM_DIGITS_PER_DISPLAY;
     digit -= (display * NUM_DIGITS_PER_DISPLAY);
+#ifndef HT16K33Disp_NO_I2C
     Wire.beginTransmission(_address + display);
     Wire.write(digit*2);
     Wire.write(data);
     Wire.write(data >> 8);
     Wire.endTransmission();
+#endif
 }
 
 void HT16K33Disp::segments_test(){
@@ -16,6 +16,10 @@
 
 #define HT16K33Disp_USEPROGMEM
 
+// Define HT16K33Disp_NO_I2C to work out every frame but skip the I2C
+// transfers, for timing the scroll code where there is no display on
+// the bus (the simavr cycle bench)
+
 #ifdef HT16K33Disp_USEPROGMEM
 const uint16_t HT16K33Disp_FourteenSegmentASCII[96] PROGMEM = {
 #else
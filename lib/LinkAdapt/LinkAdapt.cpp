@@ -0,0 +1,85 @@
+#include <Arduino.h>
+#include "LinkAdapt.h"
+
+LinkAdapt::LinkAdapt(uint16_t initial_timeout, uint16_t min_timeout, uint16_t max_timeout, uint8_t max_retries){
+    _initial_timeout = initial_timeout;
+    _min_timeout = min_timeout;
+    _max_timeout = max_timeout;
+    _max_retries = max_retries;
+    _srtt8 = 0;
+    _rttvar4 = 0;
+    _have_rtt = false;
+    _success = LINK_ADAPT_SUCCESS_START;
+}
+
+void LinkAdapt::attempt_result(bool acked){
+    if(acked)
+        _success += (256 - _success) >> LINK_ADAPT_SUCCESS_SHIFT;
+    else
+        _success -= (_success + (1 << LINK_ADAPT_SUCCESS_SHIFT) - 1) >> LINK_ADAPT_SUCCESS_SHIFT;
+}
+
+void LinkAdapt::ack_received(uint16_t rtt_ms, uint8_t tries){
+    for(uint8_t i = 1; i < tries; i++)
+        attempt_result(false);
+    attempt_result(true);
+
+    // Karn's rule: a resent message's ACK can't be timed
+    if(tries != 1)
+        return;
+    if(rtt_ms > _max_timeout)
+        rtt_ms = _max_timeout;
+    if(!_have_rtt){
+        _srtt8 = rtt_ms << 3;
+        _rttvar4 = rtt_ms << 1;     // rttvar = rtt / 2
+        _have_rtt = true;
+        return;
+    }
+    int16_t error = rtt_ms - (_srtt8 >> 3);
+    _srtt8 += error;
+    if(error < 0)
+        error = -error;
+    _rttvar4 += error - (_rttvar4 >> 2);
+}
+
+void LinkAdapt::send_failed(uint8_t tries){
+    for(uint8_t i = 0; i < tries; i++)
+        attempt_result(false);
+}
+
+uint16_t LinkAdapt::rto(){
+    if(!_have_rtt)
+        return _initial_timeout;
+    uint32_t timeout = (_srtt8 >> 3) + (uint32_t)_rttvar4;
+    if(timeout < _min_timeout)
+        return _min_timeout;
+    if(timeout > _max_timeout)
+        return _max_timeout;
+    return timeout;
+}
+
+uint16_t LinkAdapt::timeout(uint8_t attempt){
+    if(attempt > LINK_ADAPT_MAX_BACKOFF_SHIFT)
+        attempt = LINK_ADAPT_MAX_BACKOFF_SHIFT;
+    uint32_t base = (uint32_t)rto() << attempt;
+    // at least 1/8 of the wait, up to all of it as the success rate drops
+    uint32_t jitter = (base >> 3) + ((base * (uint8_t)~_success) >> 8);
+    uint32_t timeout = base + random(0, jitter + 1);
+    return timeout > 0xFFFF ? 0xFFFF : timeout;
+}
+
+uint8_t LinkAdapt::retries(){
+    if(_success < LINK_ADAPT_DEAD_LINK)
+        return 1;
+    // transmissions until the chance that all of them fail is about 1%
+    uint16_t all_missed = 256;
+    uint8_t miss = ~_success;
+    uint8_t transmissions = 0;
+    while(all_missed > LINK_ADAPT_DELIVERY_MISS && transmissions <= _max_retries){
+        all_missed = (all_missed * miss) >> 8;
+        transmissions++;
+    }
+    if(transmissions <= LINK_ADAPT_MIN_RETRIES)
+        return LINK_ADAPT_MIN_RETRIES;
+    return transmissions - 1;
+}
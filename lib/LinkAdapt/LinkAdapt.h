@@ -0,0 +1,72 @@
+#ifndef LinkAdapt_h
+#define LinkAdapt_h
+
+// Retry and timeout control for an RHReliableDatagram client, driven by
+// what the link is actually doing instead of fixed RETRIES and TIMEOUT.
+//
+// The ACK round-trip time is smoothed as in TCP (RFC 6298): srtt and its
+// mean deviation give a timeout of srtt + 4 * rttvar. A sample is only
+// taken from messages ACKed on the first try, since an ACK after a resend
+// could belong to either copy. The share of transmissions that got an
+// ACK back is kept as a moving average, from which:
+//
+//  - retries are enough for a 99% chance of delivery, at least two and up
+//    to max_retries, but only one when the link looks dead, so it is not
+//    hammered
+//  - each resend waits twice as long as the one before (up to 8 times)
+//  - the random extra wait grows as the success rate falls, since losses
+//    on a shared channel are mostly collisions with other clients
+//
+// All arithmetic is integer; success rates are out of 256.
+
+#include <Arduino.h>
+
+#define LINK_ADAPT_SUCCESS_START 192    // 75%, until there is history
+#define LINK_ADAPT_SUCCESS_SHIFT 3      // each attempt moves the average 1/8 of the way
+#define LINK_ADAPT_DEAD_LINK 32         // below 12.5% only probe with one retry
+#define LINK_ADAPT_DELIVERY_MISS 3      // about 1% of 256, the accepted chance of giving up
+#define LINK_ADAPT_MIN_RETRIES 2
+#define LINK_ADAPT_MAX_BACKOFF_SHIFT 3
+
+class LinkAdapt
+{
+public:
+    // timeouts in ms, max_timeout no more than 8000
+    LinkAdapt(uint16_t initial_timeout, uint16_t min_timeout, uint16_t max_timeout, uint8_t max_retries);
+
+    // A message was ACKed after tries transmissions; rtt_ms is from the end
+    // of the last transmission to the ACK
+    void ack_received(uint16_t rtt_ms, uint8_t tries);
+
+    // A message was given up on after tries transmissions
+    void send_failed(uint8_t tries);
+
+    // Wait for the ACK of transmission attempt (0 = first), with backoff
+    // and random jitter
+    uint16_t timeout(uint8_t attempt);
+
+    // Resends to allow after the first transmission
+    uint8_t retries();
+
+    // Timeout without backoff or jitter
+    uint16_t rto();
+
+    uint16_t srtt(){ return _srtt8 >> 3; }
+    uint16_t rttvar(){ return _rttvar4 >> 2; }
+    uint8_t success(){ return _success; }
+    uint8_t success_percent(){ return ((uint16_t)_success * 100 + 128) >> 8; }
+
+private:
+    void attempt_result(bool acked);
+
+    uint16_t _srtt8;        // smoothed RTT in ms, times 8
+    uint16_t _rttvar4;      // RTT mean deviation in ms, times 4
+    bool _have_rtt;
+    uint8_t _success;       // moving average of ACKed transmissions, out of 256
+
+    uint16_t _initial_timeout;
+    uint16_t _min_timeout;
+    uint16_t _max_timeout;
+    uint8_t _max_retries;
+};
+#endif
@@ -0,0 +1,155 @@
+#ifndef PulseFilters_h
+#define PulseFilters_h
+
+// Input filter strategies for the pulse receiver.
+//
+// A strategy turns the raw RX samples, taken every 100 us, into a filtered
+// level for the edge state machine in process_digital_filter(). That
+// function is a template on the strategy, so the choice is made at compile
+// time, with no virtual calls, and the sample path inlines.
+//
+// Every strategy has the same two members:
+//
+//   void reset();
+//   bool sample(bool raw, unsigned long now_us, uint8_t samples);
+//
+// samples is the runtime FILTER_SAMPLES setting (1 = loose, up to
+// PULSE_FILTER_MAX_SAMPLES = strict). Each strategy reads it as its own
+// kind of window, sized so that a clean edge comes through after about the
+// same delay whichever strategy is used.
+
+#include <Arduino.h>
+
+#ifndef PULSE_FILTER_MAX_SAMPLES
+#define PULSE_FILTER_MAX_SAMPLES 15
+#endif
+#define PULSE_FILTER_SAMPLE_US 100
+
+// The original filter: the level is the majority of the last N samples,
+// recounted on every sample
+class MajorityVoteFilter
+{
+public:
+    void reset(){
+        for(uint8_t i = 0; i < PULSE_FILTER_MAX_SAMPLES; i++)
+            _samples[i] = false;
+        _index = 0;
+    }
+
+    bool sample(bool raw, unsigned long now_us, uint8_t samples){
+        _samples[_index] = raw;
+        _index = (_index + 1) % samples;
+        uint8_t true_count = 0;
+        for(uint8_t i = 0; i < samples; i++){
+            if(_samples[i]) true_count++;
+        }
+        return true_count > samples / 2;
+    }
+
+private:
+    bool _samples[PULSE_FILTER_MAX_SAMPLES];
+    uint8_t _index;
+};
+
+// Median of the last N samples. For one-bit samples the median is the
+// majority, so this gives the same level as MajorityVoteFilter. It keeps the
+// window as bits in a shift register with a running count of the ones,
+// which makes each sample O(1) instead of a recount.
+class MedianFilter
+{
+public:
+    void reset(){
+        _window = 0;
+        _count = 0;
+        _samples = 0;
+    }
+
+    bool sample(bool raw, unsigned long now_us, uint8_t samples){
+        if(samples != _samples)
+            resize(samples);
+        if(_window & _oldest)
+            _count--;
+        _window <<= 1;
+        if(raw){
+            _window |= 1;
+            _count++;
+        }
+        return _count > (samples >> 1);
+    }
+
+private:
+    // rare path, when FILTER_SAMPLES is changed
+    void resize(uint8_t samples){
+        _samples = samples;
+        _oldest = (uint16_t)1 << (samples - 1);
+        _window &= (_oldest << 1) - 1;
+        _count = 0;
+        for(uint16_t bit = 1; bit && bit <= _oldest; bit <<= 1){
+            if(_window & bit) _count++;
+        }
+    }
+
+    uint16_t _window;       // newest sample in bit 0
+    uint16_t _oldest;       // bit that leaves the window on the next sample
+    uint8_t _count;
+    uint8_t _samples;
+};
+
+// Up/down counter: counts up on a high sample and down on a low one,
+// saturating at 0 and N/2 + 1. The level only changes at the ends, which
+// gives hysteresis, so noise near 50% duty cannot make it chatter.
+class IntegratorFilter
+{
+public:
+    void reset(){
+        _count = 0;
+        _level = false;
+    }
+
+    bool sample(bool raw, unsigned long now_us, uint8_t samples){
+        uint8_t limit = (samples >> 1) + 1;
+        if(raw){
+            if(_count < limit) _count++;
+        } else if(_count > 0){
+            _count--;
+        }
+        if(_count >= limit)
+            _level = true;
+        else if(_count == 0)
+            _level = false;
+        return _level;
+    }
+
+private:
+    uint8_t _count;
+    bool _level;
+};
+
+// Edge timestamp glitch rejector: follows the raw input once it has held a
+// new level for longer than half the window. It keeps no sample history,
+// only the time of the last raw edge.
+class GlitchRejectFilter
+{
+public:
+    void reset(){
+        _raw = false;
+        _level = false;
+        _edge_time = 0;
+    }
+
+    bool sample(bool raw, unsigned long now_us, uint8_t samples){
+        if(raw != _raw){
+            _raw = raw;
+            _edge_time = now_us;
+        }
+        if(raw != _level && now_us - _edge_time >= (uint16_t)(samples >> 1) * PULSE_FILTER_SAMPLE_US)
+            _level = raw;
+        return _level;
+    }
+
+private:
+    bool _raw;
+    bool _level;
+    unsigned long _edge_time;
+};
+#endif
@@ -0,0 +1,88 @@
+#include <Arduino.h>
+#include "SenderRegistry.h"
+
+SenderRegistry::SenderRegistry(){
+    clear();
+}
+
+void SenderRegistry::clear(){
+    memset(_senders, 0, sizeof(_senders));
+    for(uint8_t i = 0; i < SENDER_REGISTRY_SLOTS; i++)
+        _senders[i].address = SENDER_REGISTRY_FREE;
+    _evictions = 0;
+}
+
+// Entries are never removed, only replaced in place, so a probe can stop at
+// the first free slot
+sender_t * SenderRegistry::find(uint8_t address){
+    uint8_t slot = hash(address);
+    for(uint8_t i = 0; i < SENDER_REGISTRY_SLOTS; i++){
+        sender_t * sender = &_senders[slot];
+        if(sender->address == address)
+            return sender;
+        if(sender->address == SENDER_REGISTRY_FREE)
+            return NULL;
+        slot = (slot + 1) & (SENDER_REGISTRY_SLOTS - 1);
+    }
+    return NULL;
+}
+
+sender_t * SenderRegistry::lookup(uint8_t address){
+    uint8_t slot = hash(address);
+    sender_t * stalest = NULL;
+    for(uint8_t i = 0; i < SENDER_REGISTRY_SLOTS; i++){
+        sender_t * sender = &_senders[slot];
+        if(sender->address == address)
+            return sender;
+        if(sender->address == SENDER_REGISTRY_FREE){
+            stalest = sender;
+            break;
+        }
+        if(stalest == NULL || (long)(sender->last_seen - stalest->last_seen) < 0)
+            stalest = sender;
+        slot = (slot + 1) & (SENDER_REGISTRY_SLOTS - 1);
+    }
+
+    if(stalest->address != SENDER_REGISTRY_FREE)
+        _evictions++;
+    // received == 0 marks the first message, which is never a duplicate or a gap
+    memset(stalest, 0, sizeof(sender_t));
+    stalest->address = address;
+    return stalest;
+}
+
+bool SenderRegistry::accept(sender_t * sender, uint8_t id, bool retry, const uint8_t * payload, uint8_t length, unsigned long now){
+    sender->last_seen = now;
+    if(retry)
+        sender->retransmissions++;
+
+    if(sender->received > 0){
+        if(id == sender->last_id){
+            sender->duplicates++;
+            return false;
+        }
+        uint8_t gap = id - sender->last_id - 1;
+        if(gap <= SENDER_REGISTRY_MAX_COUNTED_GAP)
+            sender->lost += gap;
+    }
+
+    sender->last_id = id;
+    sender->received++;
+    if(length > SENDER_REGISTRY_PAYLOAD)
+        length = SENDER_REGISTRY_PAYLOAD;
+    memcpy(sender->payload, payload, length);
+    return true;
+}
+
+void SenderRegistry::report(Print & out, unsigned long now){
+    char line[64];
+    for(uint8_t i = 0; i < SENDER_REGISTRY_SLOTS; i++){
+        sender_t * sender = &_senders[i];
+        if(sender->address == SENDER_REGISTRY_FREE)
+            continue;
+        sprintf_P(line, PSTR("  0x%02x R:%u D:%u T:%u L:%u F:%u seen:%lus ago"), sender->address,
+                  sender->received, sender->duplicates, sender->retransmissions, sender->lost,
+                  sender->reply_failures, (now - sender->last_seen) / 1000);
+        out.println(line);
+    }
+}
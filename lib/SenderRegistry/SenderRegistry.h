@@ -0,0 +1,63 @@
+#ifndef SenderRegistry_h
+#define SenderRegistry_h
+
+// Fixed-size table of the RHReliableDatagram clients a base station hears.
+//
+// Entries are found by hashing the 8-bit sender address into a small open
+// addressed table, so lookup cost does not depend on how many sensors are
+// known. When the table is full the sender heard from longest ago is evicted.
+// Each entry tracks the last sequence id (for duplicate and loss detection),
+// the start of the last payload, and per-sender counters.
+
+#include <Arduino.h>
+
+#ifndef SENDER_REGISTRY_SLOTS
+#define SENDER_REGISTRY_SLOTS 8             // power of two
+#endif
+#define SENDER_REGISTRY_PAYLOAD 8           // bytes of the last message kept
+#define SENDER_REGISTRY_FREE 0xFF           // the broadcast address never sends
+#define SENDER_REGISTRY_MAX_COUNTED_GAP 16  // bigger id jumps mean the sender restarted
+
+typedef struct {
+    uint8_t address;
+    uint8_t last_id;
+    uint16_t received;          // new messages accepted
+    uint16_t duplicates;        // retransmissions of a message already accepted
+    uint16_t retransmissions;   // messages flagged as a retry by the sender
+    uint16_t lost;              // gaps in the sequence ids
+    uint16_t reply_failures;    // replies to this sender that were never ACKed
+    unsigned long last_seen;
+    uint8_t payload[SENDER_REGISTRY_PAYLOAD];
+} sender_t;
+
+class SenderRegistry
+{
+public:
+    SenderRegistry();
+
+    void clear();
+
+    // existing entry for address, or NULL
+    sender_t * find(uint8_t address);
+
+    // existing entry, or a new one (evicting the stalest if full)
+    sender_t * lookup(uint8_t address);
+
+    // Account for a received message. Returns false for a duplicate,
+    // which the caller should ACK again but not process.
+    bool accept(sender_t * sender, uint8_t id, bool retry, const uint8_t * payload, uint8_t length, unsigned long now);
+
+    // One line of counters per known sender
+    void report(Print & out, unsigned long now);
+
+    sender_t * entry(uint8_t index){ return &_senders[index]; }
+    uint8_t slots(){ return SENDER_REGISTRY_SLOTS; }
+    uint16_t evictions(){ return _evictions; }
+
+private:
+    static uint8_t hash(uint8_t address){ return (address * 0x9D) & (SENDER_REGISTRY_SLOTS - 1); }
+
+    sender_t _senders[SENDER_REGISTRY_SLOTS];
+    uint16_t _evictions;
+};
+#endif
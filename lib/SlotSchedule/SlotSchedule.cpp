@@ -0,0 +1,175 @@
+#include <Arduino.h>
+#include "SlotSchedule.h"
+
+uint16_t slot_airtime_ms(uint8_t len, uint16_t datarate){
+    return ((len + 7) * 12UL + 48) * 1000 / datarate;
+}
+
+static void put_u16(uint8_t * p, uint16_t value){
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static uint16_t get_u16(const uint8_t * p){
+    return p[0] | ((uint16_t)p[1] << 8);
+}
+
+SlotMap::SlotMap(uint8_t base_address, uint8_t slots, uint16_t slot_ms, uint8_t beacon_every){
+    _slots = slots > SLOT_SCHEDULE_MAX_SLOTS ? SLOT_SCHEDULE_MAX_SLOTS : slots;
+    _slot_ms = slot_ms;
+    _frame_ms = (unsigned long)_slots * slot_ms;
+    _beacon_every = beacon_every ? beacon_every : 1;
+    memset(_owners, SLOT_SCHEDULE_FREE, sizeof(_owners));
+    memset(_last_heard, 0, sizeof(_last_heard));
+    _owners[0] = base_address;
+    _frame_start = 0;
+    _frames_to_beacon = 0;
+    _beacon_sent = false;
+}
+
+void SlotMap::begin(unsigned long now){
+    _frame_start = now;
+    _frames_to_beacon = 0;
+    _beacon_sent = false;
+}
+
+void SlotMap::advance(unsigned long now){
+    while(now - _frame_start >= _frame_ms){
+        _frame_start += _frame_ms;
+        _frames_to_beacon = _frames_to_beacon ? _frames_to_beacon - 1 : _beacon_every - 1;
+        _beacon_sent = false;
+    }
+}
+
+// Late in slot 0 the beacon is skipped rather than run into slot 1
+bool SlotMap::beacon_due(unsigned long now){
+    advance(now);
+    return _frames_to_beacon == 0 && !_beacon_sent && now - _frame_start < _slot_ms / 2;
+}
+
+uint8_t SlotMap::beacon(uint8_t * buf, unsigned long now){
+    advance(now);
+    buf[0] = SLOT_SCHEDULE_MAGIC;
+    buf[1] = _slots;
+    buf[2] = _beacon_every;
+    put_u16(buf + 3, _slot_ms);
+    put_u16(buf + 5, now - _frame_start);
+    memcpy(buf + SLOT_SCHEDULE_HEADER, _owners, _slots);
+    _beacon_sent = true;
+    return SLOT_SCHEDULE_HEADER + _slots;
+}
+
+uint8_t SlotMap::slot_of(uint8_t address){
+    for(uint8_t slot = 1; slot < _slots; slot++){
+        if(_owners[slot] == address)
+            return slot;
+    }
+    return SLOT_SCHEDULE_NO_SLOT;
+}
+
+void SlotMap::heard(uint8_t address, unsigned long now){
+    uint8_t slot = slot_of(address);
+    if(slot == SLOT_SCHEDULE_NO_SLOT){
+        // a free slot, or one whose client has gone quiet
+        for(uint8_t i = 1; i < _slots; i++){
+            if(_owners[i] == SLOT_SCHEDULE_FREE ||
+               now - _last_heard[i] > SLOT_SCHEDULE_EXPIRY_MS){
+                slot = i;
+                break;
+            }
+        }
+        if(slot == SLOT_SCHEDULE_NO_SLOT)
+            return;
+        _owners[slot] = address;
+    }
+    _last_heard[slot] = now;
+}
+
+void SlotMap::report(Print & out){
+    char line[20];
+    for(uint8_t slot = 1; slot < _slots; slot++){
+        sprintf_P(line, PSTR("  slot %u: 0x%02x"), slot, _owners[slot]);
+        out.println(line);
+    }
+}
+
+SlotClock::SlotClock(uint8_t address){
+    _address = address;
+    _slot = SLOT_SCHEDULE_NO_SLOT;
+    _slots = 0;
+    _slot_ms = 0;
+    _beacon_every = 1;
+    _have_beacon = false;
+    _frame_start = 0;
+    _period16 = 0;
+    _nominal16 = 0;
+    _last_error = 0;
+}
+
+bool SlotClock::beacon(const uint8_t * buf, uint8_t len, unsigned long rx_start){
+    if(len < SLOT_SCHEDULE_HEADER || buf[0] != SLOT_SCHEDULE_MAGIC)
+        return false;
+    uint8_t slots = buf[1];
+    if(slots < 2 || slots > SLOT_SCHEDULE_MAX_SLOTS || len < SLOT_SCHEDULE_HEADER + slots || buf[2] == 0)
+        return false;
+    uint16_t slot_ms = get_u16(buf + 3);
+    unsigned long start = rx_start - get_u16(buf + 5);
+    unsigned long nominal16 = (unsigned long)slots * slot_ms * 16;
+
+    if(_have_beacon && slots == _slots && slot_ms == _slot_ms){
+        unsigned long elapsed = start - _frame_start;
+        unsigned long frames = elapsed < 0x08000000UL ? (elapsed * 16 + _period16 / 2) / _period16 : 0;
+        if(frames > 0){
+            _last_error = start - (_frame_start + frames * _period16 / 16);
+            // the frame length in our own ms, averaged over the last few beacons
+            long measured16 = elapsed * 16 / frames;
+            long error16 = measured16 - (long)nominal16;
+            if(labs(error16) <= (long)(nominal16 / 100 * SLOT_SCHEDULE_MAX_DRIFT_PERCENT))
+                _period16 += (measured16 - (long)_period16) / 4;
+        }
+    } else {
+        _period16 = nominal16;
+        _last_error = 0;
+    }
+
+    _nominal16 = nominal16;
+    _frame_start = start;
+    _slots = slots;
+    _slot_ms = slot_ms;
+    _beacon_every = buf[2];
+    _slot = SLOT_SCHEDULE_NO_SLOT;
+    for(uint8_t slot = 1; slot < slots; slot++){
+        if(buf[SLOT_SCHEDULE_HEADER + slot] == _address)
+            _slot = slot;
+    }
+    _have_beacon = true;
+    return true;
+}
+
+bool SlotClock::synced(unsigned long now){
+    if(!_have_beacon || _slot == SLOT_SCHEDULE_NO_SLOT)
+        return false;
+    return now - _frame_start < SLOT_SCHEDULE_LOST_BEACONS * _beacon_every * (_period16 / 16);
+}
+
+unsigned long SlotClock::wait(unsigned long now, uint16_t need_ms){
+    if(!synced(now))
+        return 0;
+    unsigned long position16 = ((now - _frame_start) * 16) % _period16;
+    unsigned long open16 = _period16 * _slot / _slots + SLOT_SCHEDULE_GUARD_MS * 16;
+    unsigned long close16 = _period16 * (_slot + 1) / _slots;
+    unsigned long need16 = (unsigned long)need_ms * 16;
+    if(open16 + need16 > close16)
+        return 0;       // never fits, don't hold the sender forever
+    if(position16 >= open16 && position16 + need16 <= close16)
+        return 0;
+    unsigned long wait16 = position16 < open16 ? open16 - position16 : _period16 - position16 + open16;
+    return (wait16 + 15) / 16;
+}
+
+long SlotClock::drift_ppm(){
+    if(!_nominal16)
+        return 0;
+    // 1000000 = 15625 * 64, kept in range for 32 bits
+    return ((long)_period16 - (long)_nominal16) * 15625 / (long)(_nominal16 / 64);
+}
@@ -0,0 +1,123 @@
+#ifndef SlotSchedule_h
+#define SlotSchedule_h
+
+// Time-slotted sending for OOK sensor clients sharing one RH_ASK channel.
+//
+// Time is divided into frames of SLOTS slots. Slot 0 belongs to the base
+// station, which broadcasts a beacon in it every few frames; every other
+// slot is given to one client, the first time the base station hears it.
+// A client that has heard a beacon with its address in it only starts a
+// transmission inside its own slot, so clients no longer collide with each
+// other, only with noise.
+//
+// Beacon payload, little endian:
+//
+//   'S', slot count, frames per beacon, slot length ms (u16),
+//   ms since the frame started when the beacon was sent (u16),
+//   owner address of each slot
+//
+// Client clocks (ceramic resonators, up to 0.5% off) drift by tens of ms
+// per frame, so SlotClock measures the frame length in its own ms between
+// beacons and predicts slots from that, not from the nominal length.
+
+#include <Arduino.h>
+
+#define SLOT_SCHEDULE_MAX_SLOTS 8
+#define SLOT_SCHEDULE_MAGIC 'S'
+#define SLOT_SCHEDULE_HEADER 7
+#define SLOT_SCHEDULE_BEACON_SIZE (SLOT_SCHEDULE_HEADER + SLOT_SCHEDULE_MAX_SLOTS)
+#define SLOT_SCHEDULE_NO_SLOT 0xFF
+#define SLOT_SCHEDULE_FREE 0                // slot owner when unassigned
+#define SLOT_SCHEDULE_GUARD_MS 40           // kept clear at the start of each slot
+#define SLOT_SCHEDULE_LOST_BEACONS 3        // beacons missed before a client goes back to free running
+#define SLOT_SCHEDULE_MAX_DRIFT_PERCENT 2   // bigger differences are a missed frame count, not drift
+
+// A client whose readings don't change only sends its heartbeat, so a slot
+// is taken back after three of the longest client heartbeat intervals
+// (HEARTBEAT_INTERVAL in ardc_send_aht20) without hearing it. One lost
+// heartbeat and its resends never cost a client its slot. Raise this with
+// any client that sends less often.
+#ifndef SLOT_SCHEDULE_HEARTBEAT_MS
+#define SLOT_SCHEDULE_HEARTBEAT_MS 300000UL
+#endif
+#define SLOT_SCHEDULE_EXPIRY_MS (3 * SLOT_SCHEDULE_HEARTBEAT_MS)
+
+// RH_ASK airtime of a frame with len payload bytes: 36 bit preamble, 12 bit
+// start symbol, then two 6-bit symbols for each of the length, 4 header,
+// payload and 2 FCS bytes
+uint16_t slot_airtime_ms(uint8_t len, uint16_t datarate);
+
+// Base station side: hands out slots and builds beacons
+class SlotMap
+{
+public:
+    SlotMap(uint8_t base_address, uint8_t slots, uint16_t slot_ms, uint8_t beacon_every);
+
+    void begin(unsigned long now);
+
+    // A message from address was received; gives it a slot if it has none
+    void heard(uint8_t address, unsigned long now);
+
+    // True when a beacon should be sent now
+    bool beacon_due(unsigned long now);
+
+    // Fills buf (SLOT_SCHEDULE_BEACON_SIZE bytes) and returns its length
+    uint8_t beacon(uint8_t * buf, unsigned long now);
+
+    uint8_t slot_of(uint8_t address);
+
+    // One line per client slot with its owner
+    void report(Print & out);
+
+    uint8_t owner(uint8_t slot){ return _owners[slot]; }
+    uint8_t slots(){ return _slots; }
+
+private:
+    void advance(unsigned long now);
+
+    uint8_t _owners[SLOT_SCHEDULE_MAX_SLOTS];
+    unsigned long _last_heard[SLOT_SCHEDULE_MAX_SLOTS];
+    uint8_t _slots;
+    uint16_t _slot_ms;
+    unsigned long _frame_ms;
+    unsigned long _frame_start;
+    uint8_t _beacon_every;
+    uint8_t _frames_to_beacon;      // 0 in a beacon frame
+    bool _beacon_sent;
+};
+
+// Client side: follows the beacons and says when its slot is open
+class SlotClock
+{
+public:
+    SlotClock(uint8_t address);
+
+    // Feed every broadcast from the base station. rx_start is when the
+    // frame started arriving (end of reception less its airtime). Returns
+    // false if it was not a beacon.
+    bool beacon(const uint8_t * buf, uint8_t len, unsigned long rx_start);
+
+    // ms until a transmission needing need_ms can start, 0 to send now.
+    // Always 0 while there is no schedule to follow (free running).
+    unsigned long wait(unsigned long now, uint16_t need_ms);
+
+    bool synced(unsigned long now);
+    uint8_t slot(){ return _slot; }
+    // Measured frame length against nominal, in parts per million
+    long drift_ppm();
+    // Beacon arrival against prediction, ms, last beacon
+    int last_error(){ return _last_error; }
+
+private:
+    uint8_t _address;
+    uint8_t _slot;
+    uint8_t _slots;
+    uint16_t _slot_ms;
+    uint8_t _beacon_every;
+    bool _have_beacon;
+    unsigned long _frame_start;     // local ms, start of the frame of the last beacon
+    unsigned long _period16;        // measured frame length, local ms times 16
+    unsigned long _nominal16;
+    int _last_error;
+};
+#endif
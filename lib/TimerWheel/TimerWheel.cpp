@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include "TimerWheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+TimerWheel::TimerWheel(){
+    _count = 0;
+    begin(0);
+}
+
+void TimerWheel::begin(unsigned long now){
+    memset(_heads, TIMER_WHEEL_NONE, sizeof(_heads));
+    for(uint8_t i = 0; i < _count; i++)
+        _timers[i].armed = false;
+    _armed = 0;
+    _tick = 0;
+    _last_ms = now;
+}
+
+timer_id_t TimerWheel::create(timer_callback_t callback, uint8_t arg){
+    if(_count == TIMER_WHEEL_TIMERS)
+        return TIMER_WHEEL_NONE;
+    timer_entry_t &timer = _timers[_count];
+    timer.callback = callback;
+    timer.arg = arg;
+    timer.armed = false;
+    return _count++;
+}
+
+void TimerWheel::link(timer_id_t id){
+    timer_entry_t &timer = _timers[id];
+    uint8_t slot = timer.expires & SLOT_MASK;
+    timer.prev = TIMER_WHEEL_NONE;
+    timer.next = _heads[slot];
+    if(timer.next != TIMER_WHEEL_NONE)
+        _timers[timer.next].prev = id;
+    _heads[slot] = id;
+    timer.armed = true;
+    _armed++;
+}
+
+void TimerWheel::unlink(timer_id_t id){
+    timer_entry_t &timer = _timers[id];
+    if(timer.prev == TIMER_WHEEL_NONE)
+        _heads[timer.expires & SLOT_MASK] = timer.next;
+    else
+        _timers[timer.prev].next = timer.next;
+    if(timer.next != TIMER_WHEEL_NONE)
+        _timers[timer.next].prev = timer.prev;
+    timer.armed = false;
+    _armed--;
+}
+
+void TimerWheel::start(timer_id_t id, unsigned long now, unsigned long delay_ms){
+    if(id >= _count)
+        return;
+    if(_timers[id].armed)
+        unlink(id);
+    // counted from the last tick, so a service() not yet run this pass
+    // can't make it early; always at least one tick ahead
+    uint32_t ticks = (now - _last_ms + delay_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    _timers[id].expires = _tick + (ticks ? ticks : 1);
+    link(id);
+}
+
+void TimerWheel::cancel(timer_id_t id){
+    if(id < _count && _timers[id].armed)
+        unlink(id);
+}
+
+unsigned long TimerWheel::remaining(timer_id_t id, unsigned long now){
+    if(id >= _count || !_timers[id].armed)
+        return 0;
+    unsigned long until = (_timers[id].expires - _tick) * (unsigned long)TIMER_WHEEL_TICK_MS;
+    unsigned long since = now - _last_ms;
+    return until > since ? until - since : 0;
+}
+
+// Runs one expired timer from the slot, false when there are none left.
+// The list is walked again from the head after every callback, since the
+// callback may have started or cancelled any timer in it.
+bool TimerWheel::run_expired(uint8_t slot, unsigned long now){
+    for(uint8_t id = _heads[slot]; id != TIMER_WHEEL_NONE; id = _timers[id].next){
+        if((int32_t)(_timers[id].expires - _tick) <= 0){
+            unlink(id);
+            _timers[id].callback(_timers[id].arg, now);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TimerWheel::service(unsigned long now){
+    unsigned long ticks = (now - _last_ms) / TIMER_WHEEL_TICK_MS;
+    if(ticks == 0)
+        return;
+    // a slot at a time, in order, so timers run in the order they were due
+    // unless more than a whole turn went by
+    unsigned long skip = _armed ? (ticks > TIMER_WHEEL_SLOTS ? ticks - TIMER_WHEEL_SLOTS : 0) : ticks;
+    _tick += skip;
+    _last_ms += skip * TIMER_WHEEL_TICK_MS;
+    ticks -= skip;
+    // _last_ms keeps step with _tick, so a callback restarting a timer
+    // during a catch-up still gets the full delay from now
+    while(ticks--){
+        _tick++;
+        _last_ms += TIMER_WHEEL_TICK_MS;
+        while(run_expired(_tick & SLOT_MASK, now))
+            ;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef TimerWheel_h
+#define TimerWheel_h
+
+// Hashed timer wheel for output actions and deadlines.
+//
+// Timers are reserved once, with their callback, from a fixed table; after
+// that starting, restarting or cancelling one is O(1) and nothing is ever
+// allocated. Time is counted in ticks of TIMER_WHEEL_TICK_MS, and a timer
+// due at tick T is kept in the list of slot T % TIMER_WHEEL_SLOTS, which
+// service() looks at once per tick. Timers longer than a turn of the wheel
+// just stay in their list until their own tick comes round, so the work per
+// tick is only the timers hashed to one slot, however many are armed.
+//
+// Ticks are counted from the ms elapsed between calls, never from millis()
+// itself, so nothing changes when millis() wraps after 49.7 days. A timer
+// never runs early and runs at most one tick late, or later if service()
+// was not called for a while; after a stall of more than a whole turn every
+// slot is looked at once, so a late service() costs at most one turn.
+//
+// Callbacks run from service(), get the time it was called with, and may
+// start or cancel any timer, including their own.
+
+#include <Arduino.h>
+
+// The sizes are compiled into TimerWheel.cpp as well, so override them
+// with build_flags, not a #define before the #include
+#ifndef TIMER_WHEEL_TIMERS
+#define TIMER_WHEEL_TIMERS 8            // at most 254
+#endif
+#ifndef TIMER_WHEEL_SLOTS
+#define TIMER_WHEEL_SLOTS 16            // power of two
+#endif
+#ifndef TIMER_WHEEL_TICK_MS
+#define TIMER_WHEEL_TICK_MS 1
+#endif
+#define TIMER_WHEEL_NONE 0xFF
+
+typedef void (*timer_callback_t)(uint8_t arg, unsigned long now);
+typedef uint8_t timer_id_t;
+
+typedef struct {
+    uint32_t expires;           // tick
+    timer_callback_t callback;
+    uint8_t arg;
+    uint8_t next;               // in the slot's list
+    uint8_t prev;
+    bool armed;
+} timer_entry_t;
+
+class TimerWheel
+{
+public:
+    TimerWheel();
+
+    void begin(unsigned long now);
+
+    // Reserves a timer that will call callback(arg); TIMER_WHEEL_NONE
+    // when the table is full. Meant for setup(), timers are never freed.
+    timer_id_t create(timer_callback_t callback, uint8_t arg);
+
+    // Arms the timer to run delay_ms (under 2^31) after now, moving it if
+    // it was already armed
+    void start(timer_id_t id, unsigned long now, unsigned long delay_ms);
+
+    void cancel(timer_id_t id);
+
+    bool active(timer_id_t id){ return _timers[id].armed; }
+
+    // ms until the timer runs, 0 if it is not armed
+    unsigned long remaining(timer_id_t id, unsigned long now);
+
+    // Runs the callbacks of timers that are due; call every loop pass
+    void service(unsigned long now);
+
+    // True when service() has something to look at: a tick has gone by
+    // with timers armed. For deciding whether the loop can sleep.
+    bool due(unsigned long now){ return _armed && now - _last_ms >= TIMER_WHEEL_TICK_MS; }
+
+    uint8_t armed(){ return _armed; }
+
+private:
+    void link(timer_id_t id);
+    void unlink(timer_id_t id);
+    bool run_expired(uint8_t slot, unsigned long now);
+
+    timer_entry_t _timers[TIMER_WHEEL_TIMERS];
+    uint8_t _heads[TIMER_WHEEL_SLOTS];
+    uint8_t _count;             // timers created
+    uint8_t _armed;             // timers armed
+    uint32_t _tick;             // ticks serviced
+    unsigned long _last_ms;     // time of tick _tick
+};
+#endif
@@ -11,6 +11,8 @@
 #include <RHReliableDatagram.h>
 #include <RH_ASK.h>
 #include <SPI.h>
+#include <LinkAdapt.h>
+#include <AsyncReply.h>
 
 AHT20 aht20;
 
@@ -28,10 +30,34 @@ AHT20 aht20;
 #endif
 
 #define DATARATE 480
-#define RETRIES 3
+// Retries and the ACK timeout adapt to the measured round trip and ACK
+// rate (lib/LinkAdapt); TIMEOUT is only the starting point
+#define RETRIES 10              // most resends allowed on a marginal link
 #define TIMEOUT 1000
-#define WAITDEL 10000 
-// 30000
+#define MIN_TIMEOUT 400         // an ACK takes 300 ms of airtime at 480 bps
+#define MAX_TIMEOUT 4000
+#define REPLY_TIMEOUT 2000      // ms to wait for the server's reply once it has ACKed a reading
+
+// A reading is taken every SAMPLE_INTERVAL but only sent when it has moved
+// past a deadband from the last reading the server ACKed, or when nothing
+// has been sent for HEARTBEAT_INTERVAL so the server still hears from us.
+// Set both deadbands to 0 to send every reading.
+#define SAMPLE_INTERVAL 10000
+#define HEARTBEAT_INTERVAL 300000  // with ENABLE_SLOTS, keep SLOT_SCHEDULE_HEARTBEAT_MS at least this
+#define TEMP_DEADBAND 0.5       // degrees F
+#define HUMID_DEADBAND 2.0      // % RH
+#define AHT20_MEASURE_TIME 80   // ms, the datasheet allows 75 ms for a measurement
+
+// Slotted sending (lib/SlotSchedule): once a beacon from a server built
+// with ENABLE_SLOTS gives us a slot, readings and resends only start inside
+// it. Until then, or after a few missed beacons, we send whenever ready.
+// #define ENABLE_SLOTS
+
+#ifdef ENABLE_SLOTS
+#include <SlotSchedule.h>
+// our reading, its ACK, the server's (shorter) reply and our ACK of that
+#define SLOT_NEED_MS (2 * slot_airtime_ms(DATASIZE, DATARATE) + 2 * slot_airtime_ms(1, DATARATE))
+#endif
 
 // Singleton instance of the radio driver
 RH_ASK driver(DATARATE, 11, 12, 10, false);
@@ -40,9 +66,21 @@ RH_ASK driver(DATARATE, 11, 12, 10, false);
  
 // Class to manage message delivery and receipt, using the driver declared above
 RHReliableDatagram manager(driver, CLIENT_ADDRESS);
+
+LinkAdapt link_control(TIMEOUT, MIN_TIMEOUT, MAX_TIMEOUT, RETRIES);
+
+// The reading's resends and our ACK of the server's reply go through
+// lib/AsyncReply, so the loop never blocks on the radio
+AsyncReply uplink(manager, driver, RETRIES, TIMEOUT);
+
+#ifdef ENABLE_SLOTS
+SlotClock slot_clock(CLIENT_ADDRESS);
+#endif
  
 // #define PTT_PIN 10
 
+unsigned long sample_time;
+
 void setup() 
 {
   Serial.begin(115200);
@@ -52,8 +90,13 @@ void setup()
   if (!manager.init())
     Serial.println("init failed");
 
-  manager.setRetries(10);
-  manager.setTimeout(TIMEOUT);
+  uplink.on_send(reading_sent);
+  uplink.on_ack(reading_acked);
+  uplink.on_failure(reading_failed);
+#ifdef ENABLE_SLOTS
+  uplink.on_idle(wait_for_slot);
+  uplink.on_broadcast(beacon_received);
+#endif
 
   Wire.begin();
   if (aht20.begin() == false)
@@ -61,8 +104,13 @@ void setup()
     Serial.println("AHT20 not detected. Please check wiring. Freezing.");
     while(true);
   }
+
+  // take the first reading straight away
+  sample_time = millis() - SAMPLE_INTERVAL;
 }
  
+// these only read the values fetched by aht20.readData(), they don't
+// start a new (blocking) measurement
 float sample_temp(){
   float temp_c, temp_f;
   temp_c = aht20.getTemperature();
@@ -84,63 +132,158 @@ uint8_t buf[RH_ASK_MAX_MESSAGE_LEN];
 int msgcount = 0;
 int ackfailcount = 0;
 int sendfailcount = 0;
- 
-void loop()
-{
-  // Serial.println("start");
+int skipcount = 0;
+
+float temp, humid;
+
+typedef enum {
+  SENSOR_IDLE,        // waiting for the next sample time
+  SENSOR_MEASURING    // measurement triggered, polling for the result
+} sensor_state_t;
+
+sensor_state_t sensor_state = SENSOR_IDLE;
+
+// Steps the AHT20 through a measurement without waiting on it;
+// returns true when a new reading is in temp and humid
+bool service_sensor(){
+  unsigned long now = millis();
+
+  switch(sensor_state){
+    case SENSOR_IDLE:
+      if(now - sample_time < SAMPLE_INTERVAL)
+        return false;
+      sample_time = now;
+      aht20.triggerMeasurement();
+      sensor_state = SENSOR_MEASURING;
+      return false;
 
-  float temp = sample_temp();
-  float humid = sample_humid();
+    case SENSOR_MEASURING:
+      // no point polling the bus before the conversion can be done
+      if(now - sample_time < AHT20_MEASURE_TIME)
+        return false;
+      if(aht20.isBusy()){
+        if(now - sample_time >= SAMPLE_INTERVAL){
+          Serial.println(F("AHT20 timed out"));
+          sensor_state = SENSOR_IDLE;
+        }
+        return false;
+      }
+      aht20.readData();
+      temp = sample_temp();
+      humid = sample_humid();
+      sensor_state = SENSOR_IDLE;
+      return true;
+  }
+  return false;
+}
 
-  Serial.print("Temp: ");
-  Serial.println(temp);
-  Serial.print("Humid: ");
-  Serial.println(humid);
+bool awaiting_reply = false;    // ACKed, waiting for the server's reply
+unsigned long reply_wait_start;
+float uplink_temp, uplink_humid;  // the reading in flight
 
-  // Serial.println("Sending to ask_reliable_datagram_server");
+// last reading the server ACKed
+bool have_sent = false;
+float sent_temp, sent_humid;
+unsigned long sent_time;
 
-  // sprintf(data, "%ld", millis());
-  // int len = strlen(data);
+bool reading_changed(){
+  if(!have_sent || millis() - sent_time >= HEARTBEAT_INTERVAL)
+    return true;
+  return fabs(temp - sent_temp) >= TEMP_DEADBAND || fabs(humid - sent_humid) >= HUMID_DEADBAND;
+}
 
+void queue_reading(){
   memcpy((void*)data, (const void *)&temp, sizeof(temp));
   memcpy((void*)data + sizeof(temp), (const void *)&humid, sizeof(humid));
+  uplink_temp = temp;
+  uplink_humid = humid;
+  uplink.queue_reply(SERVER_ADDRESS, data, DATASIZE);
+}
 
-  // for(int i = 0; i < DATASIZE; i++){
-  //   Serial.print(data[i]);
-  //   Serial.print(" ");
-  // }
-  // Serial.println();
+uint16_t reading_sent(uint8_t tries){
+  uplink.set_retries(link_control.retries());
+  return link_control.timeout(tries);
+}
 
-  // Send a message to manager_server
-  if (manager.sendtoWait(data, DATASIZE, SERVER_ADDRESS))
-  {
+void reading_acked(uint8_t to, uint8_t tries, unsigned long round_trip){
+  link_control.ack_received(round_trip, tries);
+  have_sent = true;
+  sent_temp = uplink_temp;
+  sent_humid = uplink_humid;
+  sent_time = millis();
+  reply_wait_start = sent_time;
+  awaiting_reply = true;
+}
 
-    // Now wait for a reply from the server
-    uint8_t len = sizeof(buf);
-    uint8_t from;   
-    if (manager.recvfromAckTimeout(buf, &len, 2000, &from))
-    {
-      msgcount++;
-  
-      // Serial.print("got reply from : 0x");
-      // Serial.print(from, HEX);
-      // Serial.print(": ");
-      // Serial.println((char*)buf);
-      // Serial.print("Resends: ");
-      // Serial.println(manager.retransmissions());
-      char buf[20];
-      sprintf(buf, "%d A:%d S:%d R:%d", msgcount, ackfailcount, sendfailcount, manager.retransmissions());
-      Serial.println(buf);
-    }
-    else
-    {
-      // Serial.println("No reply, is ask_reliable_datagram_server running?");
-      ackfailcount++;
-    }
+// the deadband reference is left alone, so the next reading goes out
+void reading_failed(uint8_t to){
+  link_control.send_failed(uplink.tries());
+  sendfailcount++;
+}
+
+#ifdef ENABLE_SLOTS
+// resends only start inside our slot too
+bool wait_for_slot(){
+  return uplink.state() == REPLY_SEND && slot_clock.wait(millis(), SLOT_NEED_MS);
+}
+
+// the frame started arriving one airtime before we got it
+void beacon_received(uint8_t from, uint8_t * beacon, uint8_t len){
+  if(from == SERVER_ADDRESS)
+    slot_clock.beacon(beacon, len, millis() - slot_airtime_ms(len, DATARATE));
+}
+#endif
+
+void print_counts(){
+  char line[64];
+  sprintf_P(line, PSTR("%d A:%d S:%d R:%d K:%d T:%u Q:%u%%"), msgcount, ackfailcount, sendfailcount, (int)uplink.retransmissions(), skipcount,
+            link_control.rto(), link_control.success_percent());
+  Serial.println(line);
+#ifdef ENABLE_SLOTS
+  if(slot_clock.synced(millis())){
+    sprintf_P(line, PSTR("slot %u drift %ld ppm error %d ms"), slot_clock.slot(), slot_clock.drift_ppm(),
+              slot_clock.last_error());
+    Serial.println(line);
+  }
+#endif
+}
+
+// The server's reply to an ACKed reading; a repeated reply means our ACK
+// was lost, AsyncReply ACKs it again and it is counted once
+void receive_message(){
+  uint8_t len = sizeof(buf);
+  uint8_t from, id, flags;
+  if(!uplink.receive(buf, &len, &from, &id, &flags) || from != SERVER_ADDRESS)
+    return;
+
+  if(awaiting_reply){
+    msgcount++;
+    awaiting_reply = false;
+    print_counts();
+  }
+}
+
+void loop()
+{
+  receive_message();
+  uplink.service();
+
+  if(awaiting_reply && millis() - reply_wait_start >= REPLY_TIMEOUT){
+    ackfailcount++;
+    awaiting_reply = false;
   }
-  else {
-    // Serial.println("sendtoWait failed");
-    sendfailcount++;
+
+  if(service_sensor()){
+    Serial.print("Temp: ");
+    Serial.println(temp);
+    Serial.print("Humid: ");
+    Serial.println(humid);
+
+    if(!reading_changed()){
+      skipcount++;
+    } else if(uplink.state() == REPLY_IDLE && !awaiting_reply){
+      queue_reading();
+    }
+    // otherwise the last reading is still in flight, the next sample is compared again
   }
-  delay(WAITDEL);
 }
@@ -8,6 +8,7 @@
 #include <RHReliableDatagram.h>
 #include <RH_ASK.h>
 #include <SPI.h>
+#include <LinkAdapt.h>
 
 #define PAIR1
 // #define PAIR2
@@ -23,8 +24,27 @@
 #endif
 
 #define DATARATE 480
-#define RETRIES 3
+// Retries and the ACK timeout adapt to the measured round trip and ACK
+// rate (lib/LinkAdapt); TIMEOUT is only the starting point
+#define RETRIES 10              // most resends allowed on a marginal link
 #define TIMEOUT 1000
+#define MIN_TIMEOUT 400         // an ACK takes 300 ms of airtime at 480 bps
+#define MAX_TIMEOUT 4000
+
+// RH_ASK airtime: 36 bit preamble, 12 bit start symbol, then 12 bits (two
+// 6-bit symbols) for each of the length, 4 header, payload and 2 FCS bytes
+#define FRAME_MS(len) ((((len) + 7) * 12UL + 48) * 1000 / DATARATE)
+
+// Slotted sending (lib/SlotSchedule): once a beacon from a server built
+// with ENABLE_SLOTS gives us a slot, each message waits for it, listening
+// for beacons meanwhile. Until then we send whenever ready.
+// #define ENABLE_SLOTS
+
+#ifdef ENABLE_SLOTS
+#include <SlotSchedule.h>
+// the longest count, its ACK, the server's reply and our ACK of that
+#define SLOT_NEED_MS (2 * FRAME_MS(10) + 2 * FRAME_MS(1))
+#endif
 
 // Singleton instance of the radio driver
 RH_ASK driver(DATARATE, 11, 12, 10, false);
@@ -33,6 +53,12 @@ RH_ASK driver(DATARATE, 11, 12, 10, false);
  
 // Class to manage message delivery and receipt, using the driver declared above
 RHReliableDatagram manager(driver, CLIENT_ADDRESS);
+
+LinkAdapt link_control(TIMEOUT, MIN_TIMEOUT, MAX_TIMEOUT, RETRIES);
+
+#ifdef ENABLE_SLOTS
+SlotClock slot_clock(CLIENT_ADDRESS);
+#endif
  
 // #define PTT_PIN 10
 
@@ -45,8 +71,6 @@ void setup()
   if (!manager.init())
     Serial.println("init failed");
 
-  manager.setRetries(10);
-  manager.setTimeout(TIMEOUT);
 }
  
 uint8_t data[] = "Hello World!";
@@ -56,6 +80,39 @@ uint8_t buf[RH_ASK_MAX_MESSAGE_LEN];
 int msgcount = 0;
 int ackfailcount = 0;
 int sendfailcount = 0;
+
+// recvfromAckTimeout() that hands the server's beacons to the slot clock
+// instead of taking them for its reply
+bool receive_reply(uint8_t *len, uint16_t timeout, uint8_t *from){
+  uint8_t size = *len;
+  uint8_t to;
+  unsigned long start = millis();
+  unsigned long elapsed;
+  while((elapsed = millis() - start) < timeout){
+    *len = size;
+    if(!manager.recvfromAckTimeout(buf, len, timeout - elapsed, from, &to))
+      return false;
+    if(to != RH_BROADCAST_ADDRESS)
+      return true;
+#ifdef ENABLE_SLOTS
+    if(*from == SERVER_ADDRESS)
+      slot_clock.beacon(buf, *len, millis() - FRAME_MS(*len));
+#endif
+  }
+  return false;
+}
+
+#ifdef ENABLE_SLOTS
+// listen for beacons until our slot comes round
+void wait_for_slot(){
+  unsigned long wait;
+  while((wait = slot_clock.wait(millis(), SLOT_NEED_MS)) != 0){
+    uint8_t size = sizeof(buf);
+    uint8_t from;
+    receive_reply(&size, wait > 0xFFFF ? 0xFFFF : wait, &from);
+  }
+}
+#endif
  
 void loop()
 {
@@ -63,15 +120,29 @@ void loop()
 
   sprintf(data, "%ld", millis());
   int len = strlen(data);
+
+#ifdef ENABLE_SLOTS
+  wait_for_slot();
+#endif
     
+  // sendtoWait() adds its own jitter, up to one more timeout, but no backoff
+  manager.setRetries(link_control.retries());
+  manager.setTimeout(link_control.rto());
+  uint32_t resends = manager.retransmissions();
+  unsigned long send_time = millis();
+
   // Send a message to manager_server
-  if (manager.sendtoWait(data, len, SERVER_ADDRESS))
+  bool sent = manager.sendtoWait(data, len, SERVER_ADDRESS);
+  uint8_t tries = manager.retransmissions() - resends + 1;
+  if (sent)
   {
+    // the round trip starts after our frame has gone out
+    link_control.ack_received(millis() - send_time - FRAME_MS(len), tries);
 
     // Now wait for a reply from the server
     uint8_t len = sizeof(buf);
     uint8_t from;   
-    if (manager.recvfromAckTimeout(buf, &len, 2000, &from))
+    if (receive_reply(&len, 2000, &from))
     {
       msgcount++;
   
@@ -81,8 +152,9 @@ void loop()
       // Serial.println((char*)buf);
       // Serial.print("Resends: ");
       // Serial.println(manager.retransmissions());
-      char buf[20];
-      sprintf(buf, "%d A:%d S:%d R:%d", msgcount, ackfailcount, sendfailcount, manager.retransmissions());
+      char buf[40];
+      sprintf(buf, "%d A:%d S:%d R:%d T:%u Q:%u%%", msgcount, ackfailcount, sendfailcount, manager.retransmissions(),
+              link_control.rto(), link_control.success_percent());
       Serial.println(buf);
     }
     else
@@ -93,6 +165,7 @@ void loop()
   }
   else {
     Serial.println("sendtoWait failed");
+    link_control.send_failed(tries);
     sendfailcount++;
   }
   delay(500);
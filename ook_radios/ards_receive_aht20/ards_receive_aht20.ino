@@ -11,7 +11,13 @@
 
 #include <Wire.h>
 #include <HT16K33Disp.h>
+#include <SenderRegistry.h>
+#ifndef BLOCKING_REPLY
+#include <AsyncReply.h>
+#endif
 
+// SERVER_ADDRESS is this base station; any number of clients can send to it
+// and each is tracked by its own address (see SenderRegistry below)
 #define PAIR1
 // #define PAIR2
 
@@ -25,9 +31,44 @@
 #define SERVER_ADDRESS 4
 #endif
 
+// Cycle benchmark: times compute_heat_index() across the sensor range with
+// Timer1 and halts, for running the image under simavr. RH_ASK also wants
+// Timer1, so the radio is never started in this mode.
+// #define ENABLE_CYCLE_BENCH
+
+#ifdef ENABLE_CYCLE_BENCH
+#include <CycleBench.h>
+#endif
+
 #define DATARATE 480
 #define RETRIES 3
 #define TIMEOUT 1000
+
+// Replies go out through a state machine stepped from loop(), so receiving
+// and the display scroll keep running while RH_ASK transmits and while we
+// wait for the client's ACK. Define this to go back to the inline
+// sendtoWait() for comparison; the stats line reports both the same way.
+// #define BLOCKING_REPLY
+
+// Slotted sending (lib/SlotSchedule): clients heard by this base station
+// are each given a slot in a repeating frame, announced in a beacon
+// broadcast every BEACON_EVERY frames, and a client following the beacons
+// only starts sending in its own slot. One slot is long enough for a
+// reading, its ACK, our reply and the client's ACK of it. Needs the
+// non-blocking reply pipeline and ENABLE_SLOTS in the clients.
+// #define ENABLE_SLOTS
+
+#ifdef ENABLE_SLOTS
+#include <SlotSchedule.h>
+#define SLOT_COUNT 5            // slot 0 is ours for beacons, then up to 4 clients
+#define SLOT_MS 2000            // a 10 s frame, the AHT20 clients' sample interval
+#define BEACON_EVERY 6          // frames between beacons
+#ifdef BLOCKING_REPLY
+#error "ENABLE_SLOTS needs the non-blocking reply pipeline"
+#endif
+#endif
+
+#define STATS_INTERVAL 30000    // ms between loop stall / loss reports
  
 // Singleton instance of the radio driver
 RH_ASK driver(DATARATE);
@@ -36,6 +77,15 @@ RH_ASK driver(DATARATE);
  
 // Class to manage message delivery and receipt, using the driver declared above
 RHReliableDatagram manager(driver, SERVER_ADDRESS);
+
+#ifndef BLOCKING_REPLY
+// ACKs, replies and slot beacons go out without blocking the loop
+AsyncReply reply(manager, driver, RETRIES, TIMEOUT);
+#endif
+
+#ifdef ENABLE_SLOTS
+SlotMap slot_map(SERVER_ADDRESS, SLOT_COUNT, SLOT_MS, BEACON_EVERY);
+#endif
  
 HT16K33Disp *disp1, *disp2, *disp3;
 #define DISPLAY_BRIGHTNESS 2
@@ -60,10 +110,33 @@ int temp_to_condition(char *buffer, const char *pattern, float temp){
   return index;
 }
 
+#ifdef ENABLE_CYCLE_BENCH
+CycleBench bench_heat_index("compute_heat_index", 0);
+
+void run_cycle_bench(){
+  CycleBench::init();
+  volatile float sink;
+  for(int temp = 40; temp <= 120; temp += 5){
+    for(int humid = 5; humid <= 100; humid += 5){
+      bench_heat_index.begin();
+      sink = compute_heat_index(temp, humid);
+      bench_heat_index.end();
+    }
+  }
+  (void)sink;
+  bench_heat_index.report(Serial);
+  CycleBench::halt();
+}
+#endif
+
 void setup() 
 {
   Serial.begin(115200);
 
+#ifdef ENABLE_CYCLE_BENCH
+  run_cycle_bench();
+#endif
+
   // pinMode(PTT_PIN, OUTPUT);
 
   if (!manager.init())
@@ -72,6 +145,15 @@ void setup()
   manager.setRetries(RETRIES);
   manager.setTimeout(TIMEOUT);
 
+#ifndef BLOCKING_REPLY
+  reply.on_failure(reply_failed);
+#endif
+
+#ifdef ENABLE_SLOTS
+  slot_map.begin(millis());
+  reply.on_idle(send_beacon);
+#endif
+
   Wire.begin();
   byte brightness[3] = { 1, 9, 15 }; // Green/Amber/Red
   disp1 = new HT16K33Disp(0x70, 3);
@@ -89,6 +171,82 @@ int failcount = 0;
 
 bool running1, running2, running3 = false;
 
+// the scroll keeps pointing at this between loop passes, so it can't live on the stack
+char display_text[30];
+char next_display_text[30];
+bool display_pending = false;
+
+// Every client this base station hears gets its own sequence tracking and
+// counters, so any number of sensors can share SERVER_ADDRESS
+SenderRegistry senders;
+
+// Register a message with its sender; false for a duplicate, which is
+// dropped before any decoding or display work
+bool accept_message(uint8_t from, uint8_t id, uint8_t flags, uint8_t len){
+#ifdef RH_FLAGS_RETRY
+  bool retry = flags & RH_FLAGS_RETRY;
+#else
+  bool retry = false;
+#endif
+#ifdef ENABLE_SLOTS
+  slot_map.heard(from, millis());
+#endif
+  return senders.accept(senders.lookup(from), id, retry, buf, len, millis());
+}
+
+void count_reply_failure(uint8_t to){
+  failcount++;
+  sender_t *sender = senders.find(to);
+  if(sender)
+    sender->reply_failures++;
+}
+
+#ifndef BLOCKING_REPLY
+void reply_failed(uint8_t to){
+  Serial.println("reply failed");
+  count_reply_failure(to);
+}
+
+#ifdef ENABLE_SLOTS
+// sent when the transmitter is free and no ACK is owed, ahead of any reply
+bool send_beacon(){
+  if(!slot_map.beacon_due(millis()))
+    return false;
+  uint8_t beacon[SLOT_SCHEDULE_BEACON_SIZE];
+  reply.broadcast(beacon, slot_map.beacon(beacon, millis()));
+  return true;
+}
+#endif
+
+// a retransmission because our ACK was lost is ACKed again but not reprocessed
+bool receive_message(uint8_t *len, uint8_t *from){
+  uint8_t id, flags;
+  return reply.receive(buf, len, from, &id, &flags) && accept_message(*from, id, flags, *len);
+}
+#endif
+
+unsigned long max_loop_time = 0;
+unsigned long last_stats_time = 0;
+
+void record_loop_time(unsigned long pass_start){
+  unsigned long pass_time = micros() - pass_start;
+  if(pass_time > max_loop_time)
+    max_loop_time = pass_time;
+
+  unsigned long now = millis();
+  if(now - last_stats_time >= STATS_INTERVAL){
+    last_stats_time = now;
+    char stats[64];
+    sprintf_P(stats, PSTR("R:%d F:%d stall:%lu us"), recvcount, failcount, max_loop_time);
+    Serial.println(stats);
+    senders.report(Serial, now);
+#ifdef ENABLE_SLOTS
+    slot_map.report(Serial);
+#endif
+    max_loop_time = 0;
+  }
+}
+
 void float_to_fixed(float value, char *buffer, const char *pattern, byte decimals=1){
   int split = 10 * decimals;
   int ivalue = int(value * split);
@@ -100,150 +258,181 @@ void float_to_fixed(float value, char *buffer, const char *pattern, byte decimal
 // https://www.wpc.ncep.noaa.gov/html/heatindex_equation.shtml
 // HI = -42.379 + 2.04901523*T + 10.14333127*RH - .22475541*T*RH - .00683783*T*T - .05481717*RH*RH + .00122874*T*T*RH + .00085282*T*RH*RH - .00000199*T*T*RH*RH
 
+float compute_heat_index(float temp, float humid){
+  float heat_index = 0.0;
+  float steadman_index = 0.5 * (temp + 61.0 + ((temp - 68.0) * 1.2) + (humid * 0.094));
+  float initial_index = (steadman_index + temp) / 2.0;
+  if(initial_index >= 80.0){
+    heat_index = -42.379 
+                + (2.04901523 * temp) 
+                + (10.14333127 * humid) 
+                - (0.22475541 * temp * humid) 
+                - (6.83783e-3 * pow(temp, 2)) 
+                - (5.481717e-2 * pow(humid, 2)) 
+                + (1.22874e-3 * pow(temp, 2) * humid) 
+                + (8.5282e-4 * temp * pow(humid, 2)) 
+                - (1.99e-6 * pow(temp, 2) * pow(humid, 2));
+
+    float adjust = 0.0;
+
+    if (humid < 13 && temp >= 80 && temp <= 112){
+      adjust = ( (13 - humid) / 4) * sqrt((17 - abs(temp - 95)) / 17);
+      heat_index -= adjust;
+
+    } else if (humid > 85 && temp >= 80 && temp <= 87){
+      adjust = ((humid - 85) / 10) * ((87 - temp) / 5);
+      heat_index += adjust;
+    }
+  } else {
+    heat_index = initial_index;
+  }
+  return heat_index;
+}
+
+void show_reading(){
+  // Serial.print("got request from : 0x");
+  // Serial.print(from, HEX);
+  // Serial.print(": ");
+
+  // for(int i = 0; i < sizeof(buf); i++){
+  //   Serial.print(buf[i]);
+  //   Serial.print(" ");
+  // }
+  // Serial.println();
+
+  float temp = (float)*((float *)buf);
+  float humid = (float)*((float *)buf+1);
+
+  // Serial.print("Temp: ");
+  // Serial.println(temp);
+  // Serial.print("Humid: ");
+  // Serial.println(humid);
+
+  recvcount++;
+
+  // buf[len] = '\0';
+
+  // sendtoWait() only counts its own resends
+#ifdef BLOCKING_REPLY
+  int resend_count = manager.retransmissions();
+#else
+  int resend_count = reply.retransmissions();
+#endif
+
+  // char dispbuf[30];
+  // sprintf(dispbuf, "%s %d %d", (char*)buf, recvcount, failcount);
+  // sprintf(dispbuf, "%d F%d R%d", recvcount, failcount, resend_count);
+  // Serial.println(dispbuf);
+
+  // disp1.scroll_string(dispbuf);
+
+  // Serial.print("Resends: ");
+  // Serial.println(resend_count);
+
+  float heat_index = compute_heat_index(temp, humid);
+
+  Serial.println(heat_index);
+
+  char condition[10];
+
+  int condition_index = temp_to_condition(condition, "%s",  heat_index);
+
+  char temps[10];
+  if(temp < 100.0){
+    float_to_fixed(temp, temps, "%2d.%1d");
+  } else {
+    float_to_fixed(temp, temps, "%3d.%1d");
+  }
+
+  char humids[10];
+  sprintf_P(humids, PSTR("%3d "), int(humid));
+  // float_to_fixed(humid, humids, "%3d.%1d");
+
+  char indexs[10];
+  float_to_fixed(heat_index, indexs, "%3d ");
+
+  char *buffer = next_display_text;
+
+  // switch(device_display_count){
+  //   case 1:
+  //   {
+  //     sprintf(buffer, "%4s", condition);
+  //     break;
+  //   }
+  //   case 2:
+  //   {
+  //     if(temp < 100.0){
+  //       sprintf(buffer, "%4s %4s", temps, condition);
+  //     } else {
+  //       sprintf(buffer, "%5s%4s", temps, condition);
+  //     }
+  //     break;
+  //   }
+  //   case 3:
+  //   {
+  if(condition_index < 7 || condition_index > 12){
+    if(temp < 100.0){
+      sprintf(buffer, "%4s %4s%4s", temps, indexs, condition);
+    } else {
+      sprintf(buffer, "%5s%4s%4s", temps, indexs, condition);
+    }
+  } else if(condition_index < 9 || condition_index > 10){
+    if(temp < 100.0){
+      sprintf(buffer, "%4s %4s%4s", temps, condition, indexs);
+    } else {
+      sprintf(buffer, "%5s%4s%4s", temps, condition, indexs);
+    }
+  } else{
+    if(temp < 100.0){
+      sprintf(buffer, "%4s%5s%4s", condition, temps, indexs);
+    } else {
+      sprintf(buffer, "%4s%4s %4s", condition, temps, indexs);
+    }
+  }
+    //   break;
+    // }
+  // }
+
+  display_pending = true;
+}
+
 void loop()
 {
-  if (manager.available())
+  unsigned long pass_start = micros();
+  uint8_t len = sizeof(buf);
+  uint8_t from;
+
+#ifdef BLOCKING_REPLY
+  uint8_t id, flags;
+  if (manager.available() && manager.recvfromAck(buf, &len, &from, NULL, &id, &flags) &&
+      accept_message(from, id, flags, len))
   {
-    // Wait for a message addressed to us from the client
-    uint8_t len = sizeof(buf);
-    uint8_t from;
-    if (manager.recvfromAck(buf, &len, &from))
-    {
-      // Serial.print("got request from : 0x");
-      // Serial.print(from, HEX);
-      // Serial.print(": ");
-
-      // for(int i = 0; i < sizeof(buf); i++){
-      //   Serial.print(buf[i]);
-      //   Serial.print(" ");
-      // }
-      // Serial.println();
-
-      float temp = (float)*((float *)buf);
-      float humid = (float)*((float *)buf+1);
-
-      // Serial.print("Temp: ");
-      // Serial.println(temp);
-      // Serial.print("Humid: ");
-      // Serial.println(humid);
-
-      recvcount++;
-
-      // buf[len] = '\0';
-
-      int resend_count = manager.retransmissions();
-
-      // char dispbuf[30];
-      // sprintf(dispbuf, "%s %d %d", (char*)buf, recvcount, failcount);
-      // sprintf(dispbuf, "%d F%d R%d", recvcount, failcount, resend_count);
-      // Serial.println(dispbuf);
-
-      // disp1.scroll_string(dispbuf);
-
-      // Serial.print("Resends: ");
-      // Serial.println(resend_count);
-
-      float heat_index = 0.0;
-      float steadman_index = 0.5 * (temp + 61.0 + ((temp - 68.0) * 1.2) + (humid * 0.094));
-      float initial_index = (steadman_index + temp) / 2.0;
-      if(initial_index >= 80.0){
-        heat_index = -42.379 
-                    + (2.04901523 * temp) 
-                    + (10.14333127 * humid) 
-                    - (0.22475541 * temp * humid) 
-                    - (6.83783e-3 * pow(temp, 2)) 
-                    - (5.481717e-2 * pow(humid, 2)) 
-                    + (1.22874e-3 * pow(temp, 2) * humid) 
-                    + (8.5282e-4 * temp * pow(humid, 2)) 
-                    - (1.99e-6 * pow(temp, 2) * pow(humid, 2));
-
-        float adjust = 0.0;
-
-        if (humid < 13 && temp >= 80 && temp <= 112){
-          adjust = ( (13 - humid) / 4) * sqrt((17 - abs(temp - 95)) / 17);
-          heat_index -= adjust;
-
-        } else if (humid > 85 && temp >= 80 && temp <= 87){
-          adjust = ((humid - 85) / 10) * ((87 - temp) / 5);
-          heat_index += adjust;
-        }
-      } else {
-        heat_index = initial_index;
-      }
-
-      Serial.println(heat_index);
-
-      char condition[10];
-
-      int condition_index = temp_to_condition(condition, "%s",  heat_index);
-
-      char temps[10];
-      if(temp < 100.0){
-        float_to_fixed(temp, temps, "%2d.%1d");
-      } else {
-        float_to_fixed(temp, temps, "%3d.%1d");
-      }
-
-      char humids[10];
-      sprintf_P(humids, PSTR("%3d "), int(humid));
-      // float_to_fixed(humid, humids, "%3d.%1d");
-
-      char indexs[10];
-      float_to_fixed(heat_index, indexs, "%3d ");
-
-      char buffer[30];
-
-      // switch(device_display_count){
-      //   case 1:
-      //   {
-      //     sprintf(buffer, "%4s", condition);
-      //     break;
-      //   }
-      //   case 2:
-      //   {
-      //     if(temp < 100.0){
-      //       sprintf(buffer, "%4s %4s", temps, condition);
-      //     } else {
-      //       sprintf(buffer, "%5s%4s", temps, condition);
-      //     }
-      //     break;
-      //   }
-      //   case 3:
-      //   {
-      if(condition_index < 7 || condition_index > 12){
-        if(temp < 100.0){
-          sprintf(buffer, "%4s %4s%4s", temps, indexs, condition);
-        } else {
-          sprintf(buffer, "%5s%4s%4s", temps, indexs, condition);
-        }
-      } else if(condition_index < 9 || condition_index > 10){
-        if(temp < 100.0){
-          sprintf(buffer, "%4s %4s%4s", temps, condition, indexs);
-        } else {
-          sprintf(buffer, "%5s%4s%4s", temps, condition, indexs);
-        }
-      } else{
-        if(temp < 100.0){
-          sprintf(buffer, "%4s%5s%4s", condition, temps, indexs);
-        } else {
-          sprintf(buffer, "%4s%4s %4s", condition, temps, indexs);
-        }
-      }
-        //   break;
-        // }
-      // }
-
-      unsigned long time = millis();
-      if(!running1)
-        disp1->begin_scroll_string(buffer, 100, 100);
-
-        running1 = disp1->step_scroll_string(time);
-
-      // Send a reply back to the originator client
-      if (!manager.sendtoWait(data, sizeof(data), from)){
-        Serial.println("sendtoWait failed");
-        failcount++;
-      }
+    show_reading();
+
+    // Send a reply back to the originator client
+    if (!manager.sendtoWait(data, sizeof(data), from)){
+      Serial.println("sendtoWait failed");
+      count_reply_failure(from);
     }
   }
+#else
+  if (receive_message(&len, &from))
+  {
+    show_reading();
+    reply.queue_reply(from, data, sizeof(data));
+  }
+  reply.service();
+#endif
+
+  // let a scroll in progress finish before starting the newest reading
+  if(!running1 && display_pending){
+    strcpy(display_text, next_display_text);
+    display_pending = false;
+    disp1->begin_scroll_string(display_text, 100, 100);
+    running1 = true;
+  }
+  if(running1)
+    running1 = disp1->step_scroll_string(millis());
+
+  record_loop_time(pass_start);
 }
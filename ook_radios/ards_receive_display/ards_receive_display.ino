@@ -12,7 +12,13 @@
 #include <Wire.h>
 // #include <DS3231-RTC.h>
 #include <HT16K33Disp.h>
+#include <SenderRegistry.h>
+#ifndef BLOCKING_REPLY
+#include <AsyncReply.h>
+#endif
 
+// SERVER_ADDRESS is this base station; any number of clients can send to it
+// and each is tracked by its own address (see SenderRegistry below)
 #define PAIR1
 // #define PAIR2
 
@@ -29,6 +35,32 @@
 #define DATARATE 480
 #define RETRIES 3
 #define TIMEOUT 1000
+
+// Replies go out through a state machine stepped from loop(), so receiving
+// and the display scroll keep running while RH_ASK transmits and while we
+// wait for the client's ACK. Define this to go back to the inline
+// sendtoWait() and blocking scroll_string() for comparison.
+// #define BLOCKING_REPLY
+
+// Slotted sending (lib/SlotSchedule): clients heard by this base station
+// are each given a slot in a repeating frame, announced in a beacon
+// broadcast every BEACON_EVERY frames, and a client following the beacons
+// only starts sending in its own slot. One slot is long enough for a
+// reading, its ACK, our reply and the client's ACK of it. Needs the
+// non-blocking reply pipeline and ENABLE_SLOTS in the clients.
+// #define ENABLE_SLOTS
+
+#ifdef ENABLE_SLOTS
+#include <SlotSchedule.h>
+#define SLOT_COUNT 5            // slot 0 is ours for beacons, then up to 4 clients
+#define SLOT_MS 2000            // a 10 s frame, the AHT20 clients' sample interval
+#define BEACON_EVERY 6          // frames between beacons
+#ifdef BLOCKING_REPLY
+#error "ENABLE_SLOTS needs the non-blocking reply pipeline"
+#endif
+#endif
+
+#define STATS_INTERVAL 30000    // ms between loop stall / loss reports
  
 // Singleton instance of the radio driver
 RH_ASK driver(DATARATE);
@@ -37,6 +69,15 @@ RH_ASK driver(DATARATE);
  
 // Class to manage message delivery and receipt, using the driver declared above
 RHReliableDatagram manager(driver, SERVER_ADDRESS);
+
+#ifndef BLOCKING_REPLY
+// ACKs, replies and slot beacons go out without blocking the loop
+AsyncReply reply(manager, driver, RETRIES, TIMEOUT);
+#endif
+
+#ifdef ENABLE_SLOTS
+SlotMap slot_map(SERVER_ADDRESS, SLOT_COUNT, SLOT_MS, BEACON_EVERY);
+#endif
  
 HT16K33Disp disp1(0x70, 3);
 #define DISPLAY_BRIGHTNESS 2
@@ -55,6 +96,15 @@ void setup()
   manager.setRetries(RETRIES);
   manager.setTimeout(TIMEOUT);
 
+#ifndef BLOCKING_REPLY
+  reply.on_failure(reply_failed);
+#endif
+
+#ifdef ENABLE_SLOTS
+  slot_map.begin(millis());
+  reply.on_idle(send_beacon);
+#endif
+
   Wire.begin();
   byte brightness1[3] = { DISPLAY_BRIGHTNESS, DISPLAY_BRIGHTNESS, DISPLAY_BRIGHTNESS };
   disp1.init(brightness1);
@@ -67,40 +117,152 @@ uint8_t buf[RH_ASK_MAX_MESSAGE_LEN];
 int recvcount = 0;
 int failcount = 0;
 
-void loop()
-{
-  if (manager.available())
-  {
-    // Wait for a message addressed to us from the client
-    uint8_t len = sizeof(buf);
-    uint8_t from;
-    if (manager.recvfromAck(buf, &len, &from))
-    {
-      Serial.print("got request from : 0x");
-      Serial.print(from, HEX);
-      Serial.print(": ");
+// the scroll keeps pointing at this between loop passes, so it can't live on the stack
+char display_text[30];
+char next_display_text[30];
+bool display_pending = false;
+bool scrolling = false;
+
+// Every client this base station hears gets its own sequence tracking and
+// counters, so any number of sensors can share SERVER_ADDRESS
+SenderRegistry senders;
+
+// Register a message with its sender; false for a duplicate, which is
+// dropped before any decoding or display work
+bool accept_message(uint8_t from, uint8_t id, uint8_t flags, uint8_t len){
+#ifdef RH_FLAGS_RETRY
+  bool retry = flags & RH_FLAGS_RETRY;
+#else
+  bool retry = false;
+#endif
+#ifdef ENABLE_SLOTS
+  slot_map.heard(from, millis());
+#endif
+  return senders.accept(senders.lookup(from), id, retry, buf, len, millis());
+}
+
+void count_reply_failure(uint8_t to){
+  failcount++;
+  sender_t *sender = senders.find(to);
+  if(sender)
+    sender->reply_failures++;
+}
+
+#ifndef BLOCKING_REPLY
+void reply_failed(uint8_t to){
+  Serial.println("reply failed");
+  count_reply_failure(to);
+}
 
-      recvcount++;
+#ifdef ENABLE_SLOTS
+// sent when the transmitter is free and no ACK is owed, ahead of any reply
+bool send_beacon(){
+  if(!slot_map.beacon_due(millis()))
+    return false;
+  uint8_t beacon[SLOT_SCHEDULE_BEACON_SIZE];
+  reply.broadcast(beacon, slot_map.beacon(beacon, millis()));
+  return true;
+}
+#endif
+
+// a retransmission because our ACK was lost is ACKed again but not reprocessed
+bool receive_message(uint8_t *len, uint8_t *from){
+  uint8_t id, flags;
+  return reply.receive(buf, len, from, &id, &flags) && accept_message(*from, id, flags, *len);
+}
+#endif
+
+unsigned long max_loop_time = 0;
+unsigned long last_stats_time = 0;
+
+void record_loop_time(unsigned long pass_start){
+  unsigned long pass_time = micros() - pass_start;
+  if(pass_time > max_loop_time)
+    max_loop_time = pass_time;
 
-      buf[len] = '\0';
+  unsigned long now = millis();
+  if(now - last_stats_time >= STATS_INTERVAL){
+    last_stats_time = now;
+    char stats[64];
+    sprintf_P(stats, PSTR("R:%d F:%d stall:%lu us"), recvcount, failcount, max_loop_time);
+    Serial.println(stats);
+    senders.report(Serial, now);
+#ifdef ENABLE_SLOTS
+    slot_map.report(Serial);
+#endif
+    max_loop_time = 0;
+  }
+}
 
-      int resend_count = manager.retransmissions();
+void show_message(uint8_t from, uint8_t len){
+  Serial.print("got request from : 0x");
+  Serial.print(from, HEX);
+  Serial.print(": ");
 
-      char dispbuf[30];
-      // sprintf(dispbuf, "%s %d %d", (char*)buf, recvcount, failcount);
-      sprintf(dispbuf, "%d F%d R%d", recvcount, failcount, resend_count);
-      Serial.println(dispbuf);
+  recvcount++;
 
-      disp1.scroll_string(dispbuf);
+  buf[len] = '\0';
 
-      // Serial.print("Resends: ");
-      // Serial.println(resend_count);
+  // sendtoWait() only counts its own resends
+#ifdef BLOCKING_REPLY
+  int resend_count = manager.retransmissions();
+#else
+  int resend_count = reply.retransmissions();
+#endif
+
+  // sprintf(next_display_text, "%s %d %d", (char*)buf, recvcount, failcount);
+  sprintf(next_display_text, "%d F%d R%d", recvcount, failcount, resend_count);
+  Serial.println(next_display_text);
+
+#ifdef BLOCKING_REPLY
+  disp1.scroll_string(next_display_text);
+#else
+  // shown when the scroll in progress ends; a newer message replaces it
+  display_pending = true;
+#endif
 
-      // Send a reply back to the originator client
-      if (!manager.sendtoWait(data, sizeof(data), from)){
-        Serial.println("sendtoWait failed");
-        failcount++;
-      }
+  // Serial.print("Resends: ");
+  // Serial.println(resend_count);
+}
+
+void loop()
+{
+  unsigned long pass_start = micros();
+  // Wait for a message addressed to us from the client
+  uint8_t len = sizeof(buf) - 1;
+  uint8_t from;
+
+#ifdef BLOCKING_REPLY
+  uint8_t id, flags;
+  if (manager.available() && manager.recvfromAck(buf, &len, &from, NULL, &id, &flags) &&
+      accept_message(from, id, flags, len))
+  {
+    show_message(from, len);
+
+    // Send a reply back to the originator client
+    if (!manager.sendtoWait(data, sizeof(data), from)){
+      Serial.println("sendtoWait failed");
+      count_reply_failure(from);
     }
   }
+#else
+  if (receive_message(&len, &from))
+  {
+    show_message(from, len);
+    reply.queue_reply(from, data, sizeof(data));
+  }
+  reply.service();
+
+  // let a scroll in progress finish before starting the newest message
+  if(!scrolling && display_pending){
+    strcpy(display_text, next_display_text);
+    display_pending = false;
+    disp1.begin_scroll_string(display_text);
+    scrolling = true;
+  }
+  if(scrolling)
+    scrolling = disp1.step_scroll_string(millis());
+#endif
+
+  record_loop_time(pass_start);
 }
@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""Run a CycleBench firmware image under simavr and check the results.
+
+The firmware prints one line per marker:
+
+    BENCH <name> n=<calls> min=<cycles> avg=<cycles> max=<cycles> budget=<cycles> OK|FAIL
+
+followed by "BENCH DONE", then sleeps with interrupts off, which makes
+simavr exit. This script fails if any marker is over its firmware budget,
+if the report never completes, or if avg/max grew more than --tolerance
+past the saved baseline.
+
+Each build has its own baseline, scripts/bench_baseline/<target>.json,
+where the target is the PlatformIO environment (the directory holding
+firmware.elf) or the sketch name. A marker with no baseline, or a
+baseline marker that no longer reports, fails the run until a baseline
+is saved with --save-baseline.
+
+--sketch builds an Arduino sketch with ENABLE_CYCLE_BENCH and
+lib/CycleBench through arduino-cli, then runs it the same way.
+
+The filter harness build (ENABLE_FILTER_HARNESS) also prints
+
+    FILTER <name> trace=<trace> detected=<found>/<pulses> false=<count> ram=<bytes>
+
+which is shown as a table next to the cycle counts. The receiver benches also print
+
+    DUTY active_ms=<ms> total_ms=<ms> valid=<pulses> ... max_width_us=<us>
+
+with the CPU time spent awake; it is echoed so the sleep build
+(ENABLE_SLEEP_IDLE) can be checked against the busy loop. The timer
+wheel check (ENABLE_TIMER_CHECK) prints
+
+    TIMER <check> OK|FAIL
+
+and any FAIL fails the run.
+
+    python scripts/cycle_bench.py .pio/build/nanoatmega328new_bench/firmware.elf
+    python scripts/cycle_bench.py firmware.elf --save-baseline
+    python scripts/cycle_bench.py --sketch ook_radios/ards_receive_aht20
+"""
+
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+MCU = "atmega328p"
+F_CPU = 16000000
+FQBN = "arduino:avr:nano"
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+BASELINE_DIR = os.path.join(SCRIPT_DIR, "bench_baseline")
+CYCLE_BENCH_LIB = os.path.join(SCRIPT_DIR, os.pardir, "lib", "CycleBench")
+
+BENCH_LINE = re.compile(
+    r"BENCH (\S+) n=(\d+) min=(\d+) avg=(\d+) max=(\d+) budget=(\d+) (OK|FAIL)")
+DONE_LINE = re.compile(r"BENCH DONE")
+FILTER_LINE = re.compile(r"FILTER (\S+) trace=(\S+) detected=(\d+)/(\d+) false=(\d+) ram=(\d+)")
+DUTY_LINE = re.compile(r"DUTY active_ms=(\d+) total_ms=(\d+).*")
+CHECK_LINE = re.compile(r"TIMER (\S+) (OK|FAIL)")
+ANSI_ESCAPE = re.compile(r"\x1b\[[0-9;]*m")
+
+
+def find_simavr(explicit):
+    if explicit:
+        return explicit
+    found = shutil.which("simavr")
+    if found:
+        return found
+    # PlatformIO installs it as a debug tool package
+    candidate = os.path.expanduser("~/.platformio/packages/tool-simavr/bin/simavr")
+    if os.path.exists(candidate):
+        return candidate
+    sys.exit("simavr not found; install it or pass --simavr")
+
+
+def build_sketch(sketch, fqbn, build_dir):
+    cli = shutil.which("arduino-cli")
+    if not cli:
+        sys.exit("arduino-cli not found; it is needed to build a sketch")
+    cmd = [cli, "compile", "--fqbn", fqbn, "--library", CYCLE_BENCH_LIB,
+           "--build-property", "compiler.cpp.extra_flags=-DENABLE_CYCLE_BENCH",
+           "--output-dir", build_dir, sketch]
+    if subprocess.call(cmd) != 0:
+        sys.exit("sketch build failed")
+    return os.path.join(build_dir, os.path.basename(sketch) + ".ino.elf")
+
+
+def run_simavr(simavr, elf, timeout):
+    cmd = [simavr, "-m", MCU, "-f", str(F_CPU), elf]
+    try:
+        proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                              timeout=timeout, universal_newlines=True)
+        return proc.stdout
+    except subprocess.TimeoutExpired as e:
+        output = e.stdout or ""
+        if isinstance(output, bytes):
+            output = output.decode(errors="replace")
+        return output
+
+
+def parse(output):
+    results = {}
+    filters = []
+    checks = []
+    duty = None
+    done = False
+    for line in ANSI_ESCAPE.sub("", output).splitlines():
+        match = FILTER_LINE.search(line)
+        if match:
+            filters.append(match.groups())
+            continue
+        match = DUTY_LINE.search(line)
+        if match:
+            duty = match
+            continue
+        match = CHECK_LINE.search(line)
+        if match:
+            checks.append(match.groups())
+            continue
+        match = BENCH_LINE.search(line)
+        if match:
+            name, n, lo, avg, hi, budget, status = match.groups()
+            results[name] = {
+                "n": int(n), "min": int(lo), "avg": int(avg), "max": int(hi),
+                "budget": int(budget), "ok": status == "OK",
+            }
+        elif DONE_LINE.search(line):
+            done = True
+    return results, filters, checks, duty, done
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", nargs="?")
+    parser.add_argument("--sketch", help="Arduino sketch directory to build and run")
+    parser.add_argument("--fqbn", default=FQBN, help="board for --sketch")
+    parser.add_argument("--simavr")
+    parser.add_argument("--timeout", type=int, default=120, help="seconds of host time")
+    parser.add_argument("--baseline", help="default scripts/bench_baseline/<target>.json")
+    parser.add_argument("--tolerance", type=float, default=0.10,
+                        help="allowed growth over baseline, 0.10 = 10%%")
+    parser.add_argument("--save-baseline", action="store_true")
+    args = parser.parse_args()
+
+    if args.sketch:
+        sketch = os.path.normpath(args.sketch)
+        target = os.path.basename(sketch)
+        elf = build_sketch(sketch, args.fqbn, os.path.join("build", target))
+    elif args.elf:
+        elf = args.elf
+        target = os.path.basename(os.path.dirname(os.path.abspath(elf)))
+    else:
+        parser.error("give a firmware .elf or --sketch")
+    baseline_path = args.baseline or os.path.join(BASELINE_DIR, target + ".json")
+
+    output = run_simavr(find_simavr(args.simavr), elf, args.timeout)
+    results, filters, checks, duty, done = parse(output)
+
+    if not done or not results:
+        print(output)
+        sys.exit("bench report incomplete (timed out or crashed?)")
+
+    failed = False
+    baseline = {}
+    if not args.save_baseline:
+        if os.path.exists(baseline_path):
+            with open(baseline_path) as f:
+                baseline = json.load(f)
+        else:
+            print("no baseline at %s" % baseline_path)
+
+    print("%-32s %8s %8s %8s %8s %8s" % ("marker", "calls", "min", "avg", "max", "budget"))
+    for name, r in sorted(results.items()):
+        notes = []
+        if not r["ok"]:
+            notes.append("over budget")
+        base = baseline.get(name)
+        if not base and not args.save_baseline:
+            notes.append("no baseline")
+        elif base:
+            for key in ("avg", "max"):
+                limit = base[key] * (1.0 + args.tolerance)
+                if r[key] > limit:
+                    notes.append("%s %d > baseline %d" % (key, r[key], base[key]))
+        if notes:
+            failed = True
+        print("%-32s %8d %8d %8d %8d %8d  %s" % (name, r["n"], r["min"], r["avg"], r["max"],
+                                                  r["budget"], "; ".join(notes) or "ok"))
+        print("%-32s %8s %8.1f %8.1f %8.1f us" % ("", "", r["min"] * 1e6 / F_CPU,
+                                                   r["avg"] * 1e6 / F_CPU, r["max"] * 1e6 / F_CPU))
+    for name in sorted(set(baseline) - set(results)):
+        failed = True
+        print("%-32s in the baseline but not reported" % name)
+
+    if filters:
+        # detection quality from the filter harness, to read next to the cycles above
+        print()
+        print("%-32s %-10s %10s %8s %6s" % ("filter", "trace", "detected", "false", "ram"))
+        for name, trace, detected, total, false_triggers, ram in filters:
+            print("%-32s %-10s %6s/%-3s %8s %6s" % (name, trace, detected, total, false_triggers, ram))
+        print()
+
+    if checks:
+        for name, status in checks:
+            print("%-32s %s" % ("timer check " + name, status))
+            if status != "OK":
+                failed = True
+        print()
+
+    if duty:
+        active_ms, total_ms = int(duty.group(1)), int(duty.group(2))
+        print(duty.group(0))
+        print("CPU awake %.1f%% of the run" % (100.0 * active_ms / max(total_ms, 1)))
+        print()
+
+    if args.save_baseline:
+        if not os.path.isdir(os.path.dirname(baseline_path)):
+            os.makedirs(os.path.dirname(baseline_path))
+        with open(baseline_path, "w") as f:
+            json.dump({name: {"avg": r["avg"], "max": r["max"]} for name, r in results.items()},
+                      f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("baseline saved to %s" % baseline_path)
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
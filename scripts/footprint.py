@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Report flash, .data, .bss and stack frames per module and check the budget.
+
+Reads the linker map (so only code that survived --gc-sections counts) and
+the -fstack-usage .su files from a PlatformIO build directory:
+
+    python scripts/footprint.py .pio/build/nanoatmega328new
+    python scripts/footprint.py .pio/build/nanoatmega328new --save-budget
+
+Fails if any module grows past scripts/footprint_budget.json, or if
+.data + .bss leaves less than --min-stack bytes of the 2 KB SRAM for the
+stack and heap. Peak stack at runtime comes from the firmware itself: the
+'m' tuning command prints the canary high-water mark.
+"""
+
+import argparse
+import glob
+import json
+import os
+import re
+import sys
+
+RAM_SIZE = 2048
+
+OUTPUT_SECTION = re.compile(r"^(\.\S+)\s+0x[0-9a-f]+\s+0x[0-9a-f]+")
+INPUT_SECTION = re.compile(r"^\s+(\.\S+)?\s*0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+\.o\)?)\s*$")
+ARCHIVE_MEMBER = re.compile(r"([^/\\]+)\.a\(([^)]+)\)$")
+
+
+def module_for(path):
+    path = path.replace("\\", "/")
+    member = ARCHIVE_MEMBER.search(path)
+    if member:
+        archive = member.group(1)
+        if archive == "libFrameworkArduino":
+            return "framework"
+        if "/lib" in path and ".pio/build" in path:
+            return "lib/" + archive[3:] if archive.startswith("lib") else "lib/" + archive
+        return "toolchain/" + archive
+    if "/src/" in path:
+        return "src/" + path.split("/src/", 1)[1][:-len(".o")]
+    return os.path.basename(path)
+
+
+def parse_map(map_path):
+    modules = {}
+    current = None
+    in_memory_map = False
+    with open(map_path) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("Linker script and memory map"):
+                in_memory_map = True
+                continue
+            if not in_memory_map:
+                continue
+            output = OUTPUT_SECTION.match(line)
+            if output or (line.startswith(".") and not line.startswith(". ")):
+                current = line.split()[0]
+                continue
+            # long input section names put address/size/file on the next line,
+            # which INPUT_SECTION matches on its own
+            match = INPUT_SECTION.match(line)
+            if not match or current not in (".text", ".data", ".bss"):
+                continue
+            size = int(match.group(3), 16)
+            if size == 0:
+                continue
+            entry = modules.setdefault(module_for(match.group(4)),
+                                       {"text": 0, "data": 0, "bss": 0, "stack": 0})
+            entry[current[1:]] += size
+    return modules
+
+
+def su_module(build_dir, su):
+    # src/main.cpp.su, lib<hash>/<Library>/<file>.su, FrameworkArduino/<file>.su
+    parts = os.path.relpath(su, build_dir).replace("\\", "/").split("/")
+    if parts[0] == "src":
+        return "src/" + "/".join(parts[1:])[:-len(".su")]
+    if parts[0].startswith("lib") and len(parts) > 2:
+        return "lib/" + parts[1]
+    return "framework"
+
+
+def parse_stack_usage(build_dir, modules):
+    for su in glob.glob(os.path.join(build_dir, "**", "*.su"), recursive=True):
+        module = su_module(build_dir, su)
+        with open(su) as f:
+            for line in f:
+                fields = line.rstrip("\n").split("\t")
+                if len(fields) >= 2 and fields[1].isdigit():
+                    entry = modules.setdefault(module, {"text": 0, "data": 0, "bss": 0,
+                                                        "stack": 0})
+                    entry["stack"] = max(entry["stack"], int(fields[1]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("build_dir")
+    parser.add_argument("--map", help="default: <build_dir>/firmware.map")
+    parser.add_argument("--budget", default=os.path.join(os.path.dirname(__file__),
+                                                         "footprint_budget.json"))
+    parser.add_argument("--min-stack", type=int, default=512,
+                        help="SRAM that must stay free for stack and heap")
+    parser.add_argument("--save-budget", action="store_true")
+    args = parser.parse_args()
+
+    map_path = args.map or os.path.join(args.build_dir, "firmware.map")
+    if not os.path.exists(map_path):
+        sys.exit("%s not found; build with -Wl,-Map" % map_path)
+
+    modules = parse_map(map_path)
+    parse_stack_usage(args.build_dir, modules)
+
+    budget = {}
+    if os.path.exists(args.budget) and not args.save_budget:
+        with open(args.budget) as f:
+            budget = json.load(f)
+
+    failed = False
+    totals = {"text": 0, "data": 0, "bss": 0}
+    print("%-28s %7s %7s %7s %7s  (flash = text + data)" % ("module", "flash", "data", "bss",
+                                                             "frame"))
+    for name in sorted(modules):
+        m = modules[name]
+        for key in totals:
+            totals[key] += m[key]
+        flash = m["text"] + m["data"]
+        notes = []
+        limit = budget.get(name)
+        if limit:
+            for key, value in (("flash", flash), ("data", m["data"]), ("bss", m["bss"]),
+                               ("stack", m["stack"])):
+                if key in limit and value > limit[key]:
+                    notes.append("%s %d > %d" % (key, value, limit[key]))
+        if notes:
+            failed = True
+        print("%-28s %7d %7d %7d %7d  %s" % (name, flash, m["data"], m["bss"], m["stack"],
+                                             "; ".join(notes)))
+
+    ram = totals["data"] + totals["bss"]
+    print("%-28s %7d %7d %7d" % ("total", totals["text"] + totals["data"], totals["data"],
+                                 totals["bss"]))
+    print("static RAM %d of %d bytes, %d left for stack and heap" % (ram, RAM_SIZE,
+                                                                    RAM_SIZE - ram))
+    if RAM_SIZE - ram < args.min_stack:
+        print("FAIL: less than %d bytes left for the stack" % args.min_stack)
+        failed = True
+
+    if args.save_budget:
+        with open(args.budget, "w") as f:
+            json.dump({name: {"flash": m["text"] + m["data"], "data": m["data"],
+                              "bss": m["bss"], "stack": m["stack"]}
+                       for name, m in modules.items()}, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("budget saved to %s" % args.budget)
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,15 @@
+# PlatformIO extra script: adds a "bench" target that runs the firmware
+# image under simavr and checks the CycleBench report.
+#
+#   pio run -e nanoatmega328new_bench -t bench
+
+Import("env")
+
+env.AddCustomTarget(
+    name="bench",
+    dependencies="$BUILD_DIR/${PROGNAME}.elf",
+    actions='"$PYTHONEXE" "$PROJECT_DIR/scripts/cycle_bench.py" "$BUILD_DIR/${PROGNAME}.elf" '
+            '--baseline "$PROJECT_DIR/scripts/bench_baseline/$PIOENV.json"',
+    title="Cycle Bench",
+    description="Run the firmware under simavr and check per-function cycle counts"
+)
@@ -0,0 +1,15 @@
+# PlatformIO extra script: adds a "footprint" target that reports flash,
+# .data, .bss and stack frames per module and checks them against
+# scripts/footprint_budget.json.
+#
+#   pio run -e nanoatmega328new -t footprint
+
+Import("env")
+
+env.AddCustomTarget(
+    name="footprint",
+    dependencies="$BUILD_DIR/${PROGNAME}.elf",
+    actions='"$PYTHONEXE" "$PROJECT_DIR/scripts/footprint.py" "$BUILD_DIR"',
+    title="Footprint",
+    description="Report per-module flash/RAM use and fail on budget regressions"
+)
@@ -20,36 +20,1042 @@
 #define GARAGE_DOOR_ACTIVE_TIME 2000  // Keep pin 7 HIGH for 2 seconds
 #define PULSE_TIMING_TOLERANCE 200    // Allow ±200ms tolerance for 1000ms timing
 #define GARAGE_DOOR_IGNORE_TIME 3000  // Ignore pulses for 2 seconds after activation
+#define ACTIVATION_BLINKS 3           // LED flashes after an activation
+#define LED_BLINK_MS 150
+
+// Output actions and deadlines (relay pulse, dead time, sequence expiry,
+// LED pattern) run from a timer wheel serviced once per loop pass, so the
+// loop cost does not grow with the number of pending actions
+#include <TimerWheel.h>
+
+TimerWheel timers;
 
 // Digital filter parameters (now adjustable at runtime)
 unsigned long DEBOUNCE_TIME_US = 1000;   // 1ms debounce time
 unsigned long MIN_STABLE_TIME_US = 5000; // 5ms minimum stable time before state change
-int FILTER_SAMPLES = 5;                  // Number of samples for majority vote
+int FILTER_SAMPLES = 5;                  // Filter window in samples
 unsigned long MIN_LEGIT_TIME_RUNTIME = 50000;    // 50ms in microseconds
 unsigned long MAX_LEGIT_TIME_RUNTIME = 350000;   // 350ms in microseconds
 
 #define MAX_FILTER_SAMPLES 15   // Maximum allowed filter samples
 
+// Input filter strategy from lib/PulseFilters: MajorityVoteFilter,
+// MedianFilter, IntegratorFilter or GlitchRejectFilter; the
+// nanoatmega328new_filter_bench environment compares them side by side
+#ifndef PULSE_FILTER
+#define PULSE_FILTER MajorityVoteFilter
+#endif
+#define PULSE_FILTER_MAX_SAMPLES MAX_FILTER_SAMPLES
+#include <PulseFilters.h>
+
 // Debug output control
+#ifndef DEBUG_FILTER
 #define DEBUG_FILTER 0          // Set to 1 to enable filter debugging
+#endif
+#ifndef DEBUG_PULSE_WIDTH
 #define DEBUG_PULSE_WIDTH 1     // Set to 1 to enable pulse width debugging
+#endif
+#ifndef DEBUG_STATE_CHANGES
 #define DEBUG_STATE_CHANGES 0   // Set to 1 to enable state change debugging
+#endif
+
+// Binary control and telemetry protocol (host side: tools/rfctl.py)
+// A 0x00 byte on the serial port switches from the text tuning commands to
+// COBS framed binary messages; text output is muted unless the host asks
+#define ENABLE_BINARY_PROTOCOL
+
+#ifdef ENABLE_BINARY_PROTOCOL
+#include <FramedSerial.h>
+#endif
+
+// Human-readable output goes through console so binary mode can mute it
+class ConsolePrint : public Print {
+public:
+  bool enabled = true;
+  using Print::write;
+  size_t write(uint8_t c) { return enabled ? Serial.write(c) : 1; }
+};
+
+ConsolePrint console;
+
+// Receiver statistics, kept for the binary stats snapshot
+typedef struct {
+  unsigned long valid_pulses;       // Pulses that passed the width check
+  unsigned long rejected_pulses;    // Pulses outside MIN/MAX_LEGIT_TIME_RUNTIME
+  unsigned long ignored_pulses;     // Valid pulses dropped in dead time
+  unsigned long sequence_resets;    // Sequences restarted because timing was off
+  unsigned long activations;        // Garage door activations
+  unsigned long min_width_us;       // Narrowest valid pulse
+  unsigned long max_width_us;       // Widest valid pulse
+} receiver_stats_t;
+
+receiver_stats_t receiver_stats;
+
+// Outcome of feeding one valid pulse to the activation sequence
+typedef enum {
+  SEQUENCE_IGNORED,     // In dead time after an activation
+  SEQUENCE_STARTED,     // First pulse of a new sequence
+  SEQUENCE_RESTARTED,   // Timing was off, this pulse starts a new sequence
+  SEQUENCE_ADVANCED,    // Next pulse of the sequence
+  SEQUENCE_ACTIVATED    // Sequence complete, door activated
+} sequence_result_t;
+
+// Black-box event log, kept in an EEPROM ring that survives resets
+// Record types are sequence_result_t values for valid pulses plus the
+// EVENT_* types below; pulse widths are stored in 128us units
+#define ENABLE_EVENT_LOG
+
+#ifdef ENABLE_EVENT_LOG
+#include <EventLog.h>
+
+#define EVENT_LOG_EEPROM_START 0
+#define EVENT_LOG_EEPROM_SIZE 960       // 160 slots, top 64 bytes of EEPROM left free
+#define EVENT_REJECTED 0x80             // Pulse outside the legit width range
+#define EVENT_REJECTS_SUPPRESSED 0x81   // value: rejected pulses not logged individually
+#define EVENT_DEACTIVATED 0x82          // Garage door pin back LOW
+#define EVENT_AUTH_ACCEPTED 0x83        // value: low 16 bits of the code word counter
+#define EVENT_AUTH_REJECTED 0x84        // value: reason << 8 | code word bits received
+#define EVENT_SEQUENCE_EXPIRED 0x85     // value: pulses counted when the window closed
+#define EVENT_WIDTH_SHIFT 7             // Width stored as us >> 7
+
+// Noise can reject many pulses a second; past this many per window they
+// are only counted, so a noisy site cannot wear out the EEPROM
+#define EVENT_LOG_REJECT_LIMIT 4
+#define EVENT_LOG_REJECT_WINDOW_MS 60000UL
+
+typedef struct {
+  unsigned long window_start_time;  // Start of the current rate limit window
+  byte logged_rejects;              // Rejected pulses logged in this window
+  uint16_t suppressed_rejects;      // Rejected pulses only counted in this window
+} event_log_limit_t;
+
+EventLog event_log(EVENT_LOG_EEPROM_START, EVENT_LOG_EEPROM_SIZE);
+event_log_limit_t event_log_limit;
+
+uint16_t event_width(unsigned long pulse_width) {
+  pulse_width >>= EVENT_WIDTH_SHIFT;
+  return pulse_width > 0xFFFF ? 0xFFFF : pulse_width;
+}
+
+void log_rejected_pulse(unsigned long pulse_width) {
+  if(event_log_limit.logged_rejects < EVENT_LOG_REJECT_LIMIT) {
+    event_log_limit.logged_rejects++;
+    event_log.add(EVENT_REJECTED, event_width(pulse_width));
+  } else if(event_log_limit.suppressed_rejects < 0xFFFF) {
+    event_log_limit.suppressed_rejects++;
+  }
+}
+
+// Called every loop pass: moves at most one byte to EEPROM and rolls
+// the reject rate limit window
+void service_event_log(unsigned long current_time_ms) {
+  if(current_time_ms - event_log_limit.window_start_time >= EVENT_LOG_REJECT_WINDOW_MS) {
+    if(event_log_limit.suppressed_rejects)
+      event_log.add(EVENT_REJECTS_SUPPRESSED, event_log_limit.suppressed_rejects);
+    event_log_limit.window_start_time = current_time_ms;
+    event_log_limit.logged_rejects = 0;
+    event_log_limit.suppressed_rejects = 0;
+  }
+  event_log.flush_step();
+}
+
+void print_event_record(const event_record_t &record, unsigned long time_ms) {
+  console.print(time_ms / 1000);
+  console.print('.');
+  unsigned int fraction = time_ms % 1000;
+  if(fraction < 100) console.print('0');
+  if(fraction < 10) console.print('0');
+  console.print(fraction);
+  console.print(F("s "));
+  switch(record.type) {
+    case EVENT_LOG_BOOT: console.println(F("BOOT")); return;
+    case EVENT_LOG_TIME: console.println(F("TIME")); return;
+    case EVENT_REJECTS_SUPPRESSED:
+      console.print(F("REJECTS SUPPRESSED "));
+      console.println(record.value);
+      return;
+    case EVENT_DEACTIVATED: console.println(F("DEACTIVATED")); return;
+    case EVENT_SEQUENCE_EXPIRED:
+      console.print(F("EXPIRED after "));
+      console.print(record.value);
+      console.println(F(" pulses"));
+      return;
+    case EVENT_AUTH_ACCEPTED:
+      console.print(F("AUTH ACCEPTED counter "));
+      console.println(record.value);
+      return;
+    case EVENT_AUTH_REJECTED:
+      console.print(F("AUTH REJECTED reason "));
+      console.print(record.value >> 8);
+      console.print(F(" bits "));
+      console.println(record.value & 0xFF);
+      return;
+    case EVENT_REJECTED: console.print(F("REJECTED")); break;
+    case SEQUENCE_IGNORED: console.print(F("IGNORED")); break;
+    case SEQUENCE_STARTED: console.print(F("STARTED")); break;
+    case SEQUENCE_RESTARTED: console.print(F("RESTARTED")); break;
+    case SEQUENCE_ADVANCED: console.print(F("ADVANCED")); break;
+    case SEQUENCE_ACTIVATED: console.print(F("ACTIVATED")); break;
+    default: console.print(F("TYPE ")); console.print(record.type); break;
+  }
+  console.print(F(" width "));
+  console.print(((unsigned long)record.value << EVENT_WIDTH_SHIFT) / 1000);
+  console.println(F("ms"));
+}
+
+void print_event_log() {
+  console.println(F("\n=== EVENT LOG (seconds since boot) ==="));
+  event_log.dump(print_event_record);
+  console.print(F("Pending "));
+  console.print(event_log.pending());
+  console.print(F(", dropped "));
+  console.println(event_log.dropped());
+  console.println(F("======================================\n"));
+}
+#endif
+
+// Authenticated trigger codes (transmitter side: tools/rfcode.py)
+// Instead of three evenly spaced pulses, the door opens for a sync pulse of
+// legit width followed by a 64 bit code word, one short pulse per bit,
+// carrying a counter and its MAC (lib/AuthCode). The plain pulse sequence
+// no longer activates anything in this mode. Bit pulses are below the min
+// pulse width, so keep MIN_LEGIT_TIME_RUNTIME above AUTH_BIT_MAX_US
+// #define ENABLE_AUTH_CODES
+
+#ifdef ENABLE_AUTH_CODES
+#include <AuthCode.h>
+
+#define AUTH_EEPROM_START 960           // Just after the event log
+#define AUTH_COUNTER_WINDOW 256         // Presses the remote may make out of our range
+#define AUTH_BIT_MIN_US 6000            // Bit pulses are 10ms for a 0, 25ms for a 1
+#define AUTH_BIT_THRESHOLD_US 17500
+#define AUTH_BIT_MAX_US 40000
+#define AUTH_BIT_TIMEOUT_US 200000UL    // Give up on a code word after this long without a bit
+#define AUTH_CODE_BITS (AUTH_CODE_SIZE * 8)
+
+// Reasons in EVENT_AUTH_REJECTED besides the auth_result_t values
+#define AUTH_REJECT_TIMEOUT 0x10        // Bits stopped coming
+#define AUTH_REJECT_BAD_BIT 0x11        // Pulse too short or long for a bit
+
+// Placeholder, change it before use; tools/rfcode.py --key takes the same 16 bytes
+#define AUTH_KEY { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, \
+                   0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F }
+
+const uint8_t auth_key[AUTH_CODE_KEY_SIZE] PROGMEM = AUTH_KEY;
+
+typedef struct {
+  bool active;                    // Sync pulse seen, collecting bits
+  bool verifying;                 // Code word complete, MAC rounds running
+  byte bit_count;
+  byte code[AUTH_CODE_SIZE];
+  unsigned long last_bit_time;    // us, for the bit timeout
+} code_capture_t;
+
+AuthCode auth_code(AUTH_EEPROM_START, AUTH_COUNTER_WINDOW);
+code_capture_t code_capture;
+#endif
+
+// RF occupancy survey, for checking a site before installing
+// 'v' on the tuning menu starts or stops it. Every raw RX_PIN sample goes
+// into constant-size statistics: how much of each second the channel is
+// keyed, a log2 histogram of high and low run lengths, and pulses that
+// only just missed the legit width range. One SURVEY line is printed per
+// report period
+// #define ENABLE_RF_SURVEY
+
+#ifdef ENABLE_RF_SURVEY
+#define SURVEY_BUCKET_MS 1000           // Duty cycle reported per bucket
+#define SURVEY_BUCKETS 10               // Buckets per report line
+#define SURVEY_RUN_BINS 16              // Bin n counts runs of 2^n to 2^(n+1)-1 samples
+#define SURVEY_NEAR_MISS_PERCENT 25     // How far outside MIN/MAX_LEGIT_TIME_RUNTIME is a near miss
+
+typedef struct {
+  bool active;
+  bool level;                               // Level of the current run
+  uint16_t run_samples;                     // Length of the current run, saturating
+  uint16_t bucket_samples;
+  uint16_t bucket_high;
+  byte bucket;                              // Buckets filled this period
+  unsigned long bucket_start_time;          // ms
+  byte duty[SURVEY_BUCKETS];                // Percent of samples high, per bucket
+  uint16_t high_runs[SURVEY_RUN_BINS];
+  uint16_t low_runs[SURVEY_RUN_BINS];
+  uint16_t near_short;                      // Rejected, within the margin below MIN
+  uint16_t near_long;                       // Rejected, within the margin above MAX
+  uint16_t rejected;
+  unsigned long period_valid;               // receiver_stats.valid_pulses at the period start
+  unsigned long periods;
+} survey_t;
+
+survey_t survey;
+
+void start_survey_period(unsigned long current_time_ms) {
+  bool level = survey.level;
+  uint16_t run_samples = survey.run_samples;
+  bool active = survey.active;
+  unsigned long periods = survey.periods;
+  memset(&survey, 0, sizeof(survey));
+  survey.active = active;
+  survey.level = level;                     // A run carries over into the next period
+  survey.run_samples = run_samples;
+  survey.periods = periods;
+  survey.bucket_start_time = current_time_ms;
+  survey.period_valid = receiver_stats.valid_pulses;
+}
+
+void toggle_survey(unsigned long current_time_ms) {
+  survey.active = !survey.active;
+  survey.run_samples = 0;
+  survey.periods = 0;
+  start_survey_period(current_time_ms);
+  console.println(survey.active ? F("RF survey started") : F("RF survey stopped"));
+}
+
+// Called for every filter sample, so it has to stay cheap
+void survey_sample(bool raw_input) {
+  survey.bucket_samples++;
+  if(raw_input)
+    survey.bucket_high++;
+
+  if(raw_input == survey.level) {
+    if(survey.run_samples < 0xFFFF)
+      survey.run_samples++;
+    return;
+  }
+  // edge: the run that just ended goes into its histogram
+  byte bin = 0;
+  for(uint16_t run = survey.run_samples; run > 1; run >>= 1)
+    bin++;
+  if(survey.run_samples) {
+    uint16_t *runs = survey.level ? survey.high_runs : survey.low_runs;
+    if(runs[bin] < 0xFFFF)
+      runs[bin]++;
+  }
+  survey.level = raw_input;
+  survey.run_samples = 1;
+}
+
+void survey_rejected_pulse(unsigned long pulse_width) {
+  survey.rejected++;
+  if(pulse_width < MIN_LEGIT_TIME_RUNTIME) {
+    if(pulse_width >= MIN_LEGIT_TIME_RUNTIME - MIN_LEGIT_TIME_RUNTIME / 100 * SURVEY_NEAR_MISS_PERCENT)
+      survey.near_short++;
+  } else if(pulse_width <= MAX_LEGIT_TIME_RUNTIME + MAX_LEGIT_TIME_RUNTIME / 100 * SURVEY_NEAR_MISS_PERCENT) {
+    survey.near_long++;
+  }
+}
+
+// Counts separated by commas, trailing empty bins left off
+void print_survey_counts(const uint16_t *counts) {
+  byte used = SURVEY_RUN_BINS;
+  while(used > 1 && counts[used - 1] == 0)
+    used--;
+  for(byte i = 0; i < used; i++) {
+    if(i)
+      console.print(',');
+    console.print(counts[i]);
+  }
+}
+
+// SURVEY <period> duty=<% per bucket> hi=<runs per bin> lo=<runs per bin> near=<short>/<long> rej=<n> valid=<n>
+void print_survey_report() {
+  console.print(F("SURVEY "));
+  console.print(survey.periods);
+  console.print(F(" duty="));
+  for(byte i = 0; i < survey.bucket; i++) {
+    if(i)
+      console.print(',');
+    console.print(survey.duty[i]);
+  }
+  console.print(F(" hi="));
+  print_survey_counts(survey.high_runs);
+  console.print(F(" lo="));
+  print_survey_counts(survey.low_runs);
+  console.print(F(" near="));
+  console.print(survey.near_short);
+  console.print('/');
+  console.print(survey.near_long);
+  console.print(F(" rej="));
+  console.print(survey.rejected);
+  console.print(F(" valid="));
+  console.println(receiver_stats.valid_pulses - survey.period_valid);
+}
+
+// Called every loop pass: closes buckets and prints a line per period
+void service_survey(unsigned long current_time_ms) {
+  if(!survey.active || current_time_ms - survey.bucket_start_time < SURVEY_BUCKET_MS)
+    return;
+  survey.bucket_start_time += SURVEY_BUCKET_MS;
+  survey.duty[survey.bucket++] = survey.bucket_samples ?
+    ((unsigned long)survey.bucket_high * 100 + survey.bucket_samples / 2) / survey.bucket_samples : 0;
+  survey.bucket_samples = 0;
+  survey.bucket_high = 0;
+  if(survey.bucket < SURVEY_BUCKETS)
+    return;
+  survey.periods++;
+  print_survey_report();
+  start_survey_period(current_time_ms);
+}
+#endif
+
+// Event-driven idle mode, for battery-backed installs
+// Between loop passes the CPU sleeps in idle mode, where millis() and the
+// serial port keep running. Timer2 wakes it for every 100us input sample
+// while there is a pulse to follow; once the input has been low for a full
+// filter window and nothing else is pending the timer stops, and only a
+// pin change on RX_PIN or serial input wakes the loop again
+// #define ENABLE_SLEEP_IDLE
+
+#ifdef ENABLE_SLEEP_IDLE
+#include <avr/sleep.h>
+
+#define SAMPLE_TIMER_TOP (F_CPU / 8 / 1000000UL * PULSE_FILTER_SAMPLE_US - 1)  // CTC at clk/8
+#define SLEEP_QUIET_US (MAX_FILTER_SAMPLES * PULSE_FILTER_SAMPLE_US)  // Input low this long before the timer stops
+#define SAMPLE_BACKLOG_TICKS MAX_FILTER_SAMPLES  // Pending ticks kept through a slow pass
+
+typedef struct {
+  volatile unsigned long ticks;   // Sample timer ticks since it was started
+  volatile bool pin_changed;      // RX_PIN edge while the timer was stopped
+  unsigned long ticks_seen;       // Ticks already handed to the loop
+  unsigned long dropped_ticks;    // Ticks skipped because the loop fell too far behind
+  bool sampling;                  // Sample timer running
+  unsigned long clock_base_us;    // micros() when the sample timer started
+  unsigned long last_high_us;     // Last sample with the input high
+  unsigned long asleep_ms;        // Time spent in sleep_cpu()
+  unsigned long asleep_us;        // Remainder under 1ms, not yet in asleep_ms
+  unsigned long wakes;            // Times the CPU woke up
+  unsigned long timer_starts;     // Times a pin change restarted the sample timer
+} sleep_state_t;
+
+sleep_state_t sleep_state;
+
+ISR(TIMER2_COMPA_vect) {
+  sleep_state.ticks++;
+}
+
+// RX_PIN 6 is PD6, PCINT22 in the PCINT2 group
+ISR(PCINT2_vect) {
+  sleep_state.pin_changed = true;
+}
+
+void start_sample_timer() {
+  TCCR2B = 0;
+  TCNT2 = 0;
+  TIFR2 = _BV(OCF2A);
+  *digitalPinToPCMSK(RX_PIN) &= ~_BV(digitalPinToPCMSKbit(RX_PIN));
+  noInterrupts();
+  sleep_state.ticks = 0;
+  sleep_state.pin_changed = false;
+  interrupts();
+  sleep_state.ticks_seen = 0;
+  sleep_state.clock_base_us = micros();
+  sleep_state.last_high_us = sleep_state.clock_base_us;
+  sleep_state.sampling = true;
+  TCCR2B = _BV(CS21);
+}
+
+void stop_sample_timer() {
+  TCCR2B = 0;
+  sleep_state.sampling = false;
+  *digitalPinToPCMSK(RX_PIN) |= _BV(digitalPinToPCMSKbit(RX_PIN));
+  // an edge just before the mask went on would otherwise be missed
+  if(digitalRead(RX_PIN))
+    start_sample_timer();
+}
+
+void init_sleep_idle() {
+  TCCR2A = _BV(WGM21);
+  OCR2A = SAMPLE_TIMER_TOP;
+  TIMSK2 = _BV(OCIE2A);
+  *digitalPinToPCICR(RX_PIN) |= _BV(digitalPinToPCICRbit(RX_PIN));
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  start_sample_timer();
+}
+
+// Time of the oldest sample tick the filter has not had yet. Ticks are
+// exactly 100us apart, unlike a micros() read some way into a wake-up. A
+// pass longer than a tick leaves the rest pending, and wait_for_event()
+// returns at once until there has been one pass per tick; the input is
+// read when the pass runs, so those samples are late but not skipped. More
+// than SAMPLE_BACKLOG_TICKS behind, the oldest are dropped and counted
+unsigned long sample_clock_us() {
+  if(!sleep_state.sampling)
+    return micros();
+  noInterrupts();
+  unsigned long ticks = sleep_state.ticks;
+  interrupts();
+  if(ticks - sleep_state.ticks_seen > SAMPLE_BACKLOG_TICKS) {
+    sleep_state.dropped_ticks += ticks - sleep_state.ticks_seen - SAMPLE_BACKLOG_TICKS;
+    sleep_state.ticks_seen = ticks - SAMPLE_BACKLOG_TICKS;
+  }
+  if(sleep_state.ticks_seen != ticks)
+    sleep_state.ticks_seen++;
+  return sleep_state.clock_base_us + sleep_state.ticks_seen * PULSE_FILTER_SAMPLE_US;
+}
+
+// Sleeps until there is something for a loop pass to do. Timer0 keeps
+// running for millis(), so its overflow still wakes the CPU about every
+// 1ms; each of those wake-ups only repeats the checks below. Only the time
+// from just before sleep_cpu() to just after it counts as asleep, not the
+// checks in between
+void wait_for_event() {
+  while(true) {
+    noInterrupts();
+    if(sleep_state.ticks != sleep_state.ticks_seen || sleep_state.pin_changed || Serial.available() ||
+       timers.due(millis())) {
+      interrupts();
+      break;
+    }
+    // micros() leaves interrupts off, so nothing can slip in before the sleep
+    unsigned long sleep_start_us = micros();
+    // sei() lets one more instruction run, so no wake-up is lost before sleep
+    sleep_enable();
+    interrupts();
+    sleep_cpu();
+    sleep_disable();
+    sleep_state.wakes++;
+    sleep_state.asleep_us += micros() - sleep_start_us;
+    sleep_state.asleep_ms += sleep_state.asleep_us / 1000;
+    sleep_state.asleep_us %= 1000;
+  }
+  if(sleep_state.pin_changed && !sleep_state.sampling) {
+    sleep_state.timer_starts++;
+    start_sample_timer();
+  }
+}
+#endif
+
+// Time the CPU has been awake since boot
+unsigned long cpu_active_ms() {
+#ifdef ENABLE_SLEEP_IDLE
+  return millis() - sleep_state.asleep_ms;
+#else
+  return millis();    // The loop never sleeps
+#endif
+}
+
+void print_duty_cycle() {
+  unsigned long total_ms = millis();
+  unsigned long active_ms = cpu_active_ms();
+  console.print(F("CPU active "));
+  console.print(active_ms);
+  console.print(F(" of "));
+  console.print(total_ms);
+  console.print(F(" ms ("));
+  // active_ms * 1000 overflows after 71 minutes up
+  unsigned long per_mille = total_ms < 1000 ? 1000 :
+    total_ms < 4294967UL ? active_ms * 1000 / total_ms : active_ms / (total_ms / 1000);
+  console.print(per_mille / 10);
+  console.print('.');
+  console.print(per_mille % 10);
+  console.println(F("%)"));
+#ifdef ENABLE_SLEEP_IDLE
+  console.print(F("Wakes: "));
+  console.print(sleep_state.wakes);
+  console.print(F(", sample timer restarts: "));
+  console.print(sleep_state.timer_starts);
+  console.print(F(", samples dropped: "));
+  console.println(sleep_state.dropped_ticks);
+#endif
+}
+
+// Cycle benchmark (built by the nanoatmega328new_bench environment)
+// Replaces RX_PIN with a synthetic pulse train, times the hot functions
+// with Timer1 and halts after BENCH_RUN_TIME_MS so simavr exits
+// #define ENABLE_CYCLE_BENCH
+
+#ifdef ENABLE_CYCLE_BENCH
+#include <CycleBench.h>
+
+#if defined(ENABLE_SLEEP_IDLE) && defined(ENABLE_AUTH_CODES)
+#error "The sleep bench only plays the plain pulse train onto RX_PIN"
+#endif
+
+#ifdef ENABLE_AUTH_CODES
+#define BENCH_RUN_TIME_MS 12000       // Two code words
+#define BENCH_AUTH_FRAME_MS 6000      // Sync pulse, code word, then the dead time
+#define BENCH_AUTH_BITS_AT_MS 200     // Bit timing as sent by tools/rfcode.py
+#define BENCH_AUTH_SLOT_MS 40
+#define BENCH_AUTH_BIT0_MS 10
+#define BENCH_AUTH_BIT1_MS 25
+#define BENCH_AUTH_FRAMES (BENCH_RUN_TIME_MS / BENCH_AUTH_FRAME_MS)
+#else
+#define BENCH_RUN_TIME_MS 8000        // Long enough for two activations
+#endif
+#define BENCH_PULSE_WIDTH_MS 150      // Synthetic pulse width
+#define BENCH_GLITCH_AT_MS 500        // Noise spike in each gap...
+#define BENCH_GLITCH_WIDTH_MS 2       // ...short enough for the filter to reject
+
+// Worst-case budgets in CPU cycles (16 per microsecond), 0 = report only
+#ifndef BENCH_BUDGET_FILTER
+#define BENCH_BUDGET_FILTER 1600      // Must fit inside one 100us sample period
+#endif
+#ifndef BENCH_BUDGET_SEQUENCE
+#define BENCH_BUDGET_SEQUENCE 0
+#endif
+#ifndef BENCH_BUDGET_LOOP
+#define BENCH_BUDGET_LOOP 0
+#endif
+#ifndef BENCH_BUDGET_SCROLL
+#define BENCH_BUDGET_SCROLL 0
+#endif
+#ifndef BENCH_BUDGET_TIMERS
+#define BENCH_BUDGET_TIMERS 0
+#endif
+#ifndef BENCH_BUDGET_AUTH
+#define BENCH_BUDGET_AUTH 800         // Half a sample period, the filter gets the rest
+#endif
+
+CycleBench bench_filter("process_digital_filter", BENCH_BUDGET_FILTER);
+CycleBench bench_sequence("process_garage_door_sequence", BENCH_BUDGET_SEQUENCE);
+CycleBench bench_loop("loop_pass", BENCH_BUDGET_LOOP);
+CycleBench bench_timers("timers_service", BENCH_BUDGET_TIMERS);
+#ifdef ENABLE_DISPLAY
+// Frames only: the display bench builds with HT16K33Disp_NO_I2C
+CycleBench bench_scroll("step_scroll_string", BENCH_BUDGET_SCROLL);
+#endif
+#ifdef ENABLE_AUTH_CODES
+CycleBench bench_auth("auth_verify_step", BENCH_BUDGET_AUTH);
+
+byte bench_codes[BENCH_AUTH_FRAMES][AUTH_CODE_SIZE];
+
+// One code word per frame, signed before the run starts, with counters
+// following on from the one in EEPROM
+void bench_sign_codes() {
+  for(byte i = 0; i < BENCH_AUTH_FRAMES; i++)
+    auth_code.sign(auth_code.counter() + 1 + i, bench_codes[i]);
+}
+
+// Stand-in for an authenticating remote: a sync pulse, then one bit per slot
+bool bench_rx_input(unsigned long current_time_us) {
+  unsigned long time_ms = current_time_us / 1000;
+  unsigned long frame = time_ms / BENCH_AUTH_FRAME_MS;
+  unsigned long phase_ms = time_ms % BENCH_AUTH_FRAME_MS;
+  if(frame >= BENCH_AUTH_FRAMES)
+    return false;
+  if(phase_ms < BENCH_PULSE_WIDTH_MS)
+    return true;
+  if(phase_ms < BENCH_AUTH_BITS_AT_MS)
+    return false;
+  unsigned long slot = (phase_ms - BENCH_AUTH_BITS_AT_MS) / BENCH_AUTH_SLOT_MS;
+  if(slot >= AUTH_CODE_BITS)
+    return false;
+  unsigned long slot_ms = (phase_ms - BENCH_AUTH_BITS_AT_MS) % BENCH_AUTH_SLOT_MS;
+  bool bit = bench_codes[frame][slot >> 3] & (1 << (slot & 7));
+  return slot_ms < (bit ? BENCH_AUTH_BIT1_MS : BENCH_AUTH_BIT0_MS);
+}
+#elif defined(ENABLE_SLEEP_IDLE)
+// With the CPU asleep the synthetic input has to be a real pin edge, so
+// the same pulse train is played onto RX_PIN, set as an output (which
+// still raises pin change interrupts), from Timer1 compare B
+#define BENCH_CYCLES_PER_MS (F_CPU / 1000)
+#define BENCH_SEGMENTS 4
+
+// Alternating high and low times, starting high
+const unsigned int bench_segments_ms[BENCH_SEGMENTS] = {
+  BENCH_PULSE_WIDTH_MS,
+  BENCH_GLITCH_AT_MS - BENCH_PULSE_WIDTH_MS,
+  BENCH_GLITCH_WIDTH_MS,
+  PULSE_SEQUENCE_INTERVAL - BENCH_GLITCH_AT_MS - BENCH_GLITCH_WIDTH_MS
+};
+
+volatile byte bench_segment;
+volatile unsigned long bench_next_edge;   // In CycleBench::now() cycles
+
+void bench_start_stimulus() {
+  pinMode(RX_PIN, OUTPUT);
+  digitalWrite(RX_PIN, HIGH);
+  bench_segment = 0;
+  bench_next_edge = CycleBench::now() + bench_segments_ms[0] * BENCH_CYCLES_PER_MS;
+  OCR1B = (uint16_t)bench_next_edge;
+  TIFR1 = _BV(OCF1B);
+  TIMSK1 |= _BV(OCIE1B);
+}
+
+// Matches once per Timer1 wrap; only the match in the right wrap is an edge
+ISR(TIMER1_COMPB_vect) {
+  if((long)(CycleBench::now() - bench_next_edge) < 0)
+    return;
+  if(++bench_segment == BENCH_SEGMENTS)
+    bench_segment = 0;
+  digitalWrite(RX_PIN, (bench_segment & 1) ? LOW : HIGH);
+  bench_next_edge += bench_segments_ms[bench_segment] * BENCH_CYCLES_PER_MS;
+  OCR1B = (uint16_t)bench_next_edge;
+}
+#else
+// Stand-in for the RE-99 output: one valid pulse per sequence interval
+// plus a glitch in every gap, so both filter paths get exercised
+bool bench_rx_input(unsigned long current_time_us) {
+  unsigned long phase_ms = (current_time_us / 1000) % PULSE_SEQUENCE_INTERVAL;
+  if(phase_ms < BENCH_PULSE_WIDTH_MS)
+    return true;
+  return phase_ms >= BENCH_GLITCH_AT_MS && phase_ms < BENCH_GLITCH_AT_MS + BENCH_GLITCH_WIDTH_MS;
+}
+#endif
+
+void bench_report_and_halt() {
+  bool ok = true;
+  ok &= bench_filter.report(Serial);
+  ok &= bench_sequence.report(Serial);
+  ok &= bench_loop.report(Serial);
+  ok &= bench_timers.report(Serial);
+#ifdef ENABLE_DISPLAY
+  ok &= bench_scroll.report(Serial);
+#endif
+#ifdef ENABLE_AUTH_CODES
+  ok &= bench_auth.report(Serial);
+#endif
+  // what the receiver saw and how long it was awake for it, to compare
+  // the sleep build against the busy loop
+  Serial.print(F("DUTY active_ms="));
+  Serial.print(cpu_active_ms());
+  Serial.print(F(" total_ms="));
+  Serial.print(millis());
+  Serial.print(F(" valid="));
+  Serial.print(receiver_stats.valid_pulses);
+  Serial.print(F(" rejected="));
+  Serial.print(receiver_stats.rejected_pulses);
+  Serial.print(F(" activations="));
+  Serial.print(receiver_stats.activations);
+  Serial.print(F(" min_width_us="));
+  Serial.print(receiver_stats.min_width_us);
+  Serial.print(F(" max_width_us="));
+#ifdef ENABLE_SLEEP_IDLE
+  Serial.print(receiver_stats.max_width_us);
+  Serial.print(F(" dropped_ticks="));
+  Serial.println(sleep_state.dropped_ticks);
+#else
+  Serial.println(receiver_stats.max_width_us);
+#endif
+  Serial.println(ok ? F("BENCH RESULT OK") : F("BENCH RESULT FAIL"));
+  CycleBench::halt();
+}
+#endif
+
+// RAM usage reporting
+// Free RAM is painted with a canary before constructors run; whatever the
+// stack has never reached still holds it, which gives the peak stack depth.
+// The paint runs in .init3, after .init2 has cleared r1 and set SP, and
+// before .init4 copies .data and clears .bss, so it never touches either
+#define STACK_CANARY 0xC5
+
+extern uint8_t _end;       // End of .bss, start of the heap
+extern uint8_t __stack;    // Top of RAM, where the stack starts
+extern char *__brkval;     // Top of the heap, 0 until the first malloc
+
+void paint_stack() __attribute__((naked, used, section(".init3")));
+void paint_stack() {
+  for(uint8_t *p = &_end; p <= &__stack; p++)
+    *p = STACK_CANARY;
+}
+
+// With ENABLE_DISPLAY the displays are allocated with new, which takes the
+// bottom of the painted area; the scan starts above the heap so those
+// objects are not counted as stack
+const uint8_t *stack_floor() {
+  return __brkval ? (const uint8_t *)__brkval : &_end;
+}
+
+// Bytes between the heap top and the deepest the stack has ever gone
+unsigned int stack_never_used() {
+  const uint8_t *p = stack_floor();
+  while(p <= &__stack && *p == STACK_CANARY)
+    p++;
+  return p - stack_floor();
+}
+
+unsigned int stack_peak_used() {
+  return (&__stack - stack_floor() + 1) - stack_never_used();
+}
+
+void print_memory_report() {
+  console.print(F("RAM: .data+.bss "));
+  console.print((unsigned int)(&_end - (uint8_t *)RAMSTART));
+  console.print(F(" bytes, peak stack "));
+  console.print(stack_peak_used());
+  console.print(F(" bytes, never used "));
+  console.print(stack_never_used());
+  console.println(F(" bytes"));
+}
+
+
+#ifdef ENABLE_BINARY_PROTOCOL
+// Message types, host to board
+#define MSG_GET 0x01            // body: param ids, reply MSG_VALUES
+#define MSG_SET 0x02            // body: (id, u32) pairs applied all-or-nothing, reply MSG_ACK
+#define MSG_GET_STATS 0x03      // reply MSG_STATS
+#define MSG_CONFIG 0x04         // body: CONFIG_* flags, reply MSG_ACK
+#define MSG_DUMP_LOG 0x05       // reply MSG_LOG frames, then MSG_ACK
+
+// Message types, board to host
+#define MSG_ACK 0x80            // body: status, offending param id
+#define MSG_VALUES 0x81         // body: (id, u32) pairs
+#define MSG_STATS 0x82          // body: receiver_stats_t fields, uptime ms, bad frames, CPU active ms
+#define MSG_PULSE 0x83          // body: width us, interval ms, result, pulse count
+#define MSG_LOG 0x84            // body: (type, time ms, value) records, oldest first
+
+#define ACK_OK 0
+#define ACK_BAD_LENGTH 1
+#define ACK_UNKNOWN_TYPE 2
+#define ACK_UNKNOWN_PARAM 3
+#define ACK_BAD_VALUE 4
+
+#define CONFIG_STREAM_PULSES 0x01   // Send MSG_PULSE for every pulse
+#define CONFIG_TEXT_OUTPUT 0x02     // Keep the human-readable output going
+#define CONFIG_TEXT_MODE 0x04       // Leave binary mode, back to tuning commands
+
+// MSG_PULSE result for pulses the filter rejected on width, otherwise a sequence_result_t
+#define PULSE_REJECTED 0x80
+
+#define PARAM_FILTER_SAMPLES 1
+#define PARAM_MIN_STABLE_TIME_US 2
+#define PARAM_DEBOUNCE_TIME_US 3
+#define PARAM_MIN_LEGIT_TIME_US 4
+#define PARAM_MAX_LEGIT_TIME_US 5
+#define PARAM_COUNT 5
+
+typedef struct {
+  bool active;            // Serial input is framed binary, not tuning commands
+  bool stream_pulses;     // Send MSG_PULSE events
+  byte event_seq;         // Sequence number for unsolicited messages
+} protocol_state_t;
+
+protocol_state_t protocol_state;
+FramedSerial protocol(Serial);
+
+bool read_param(byte id, uint32_t *value) {
+  switch(id) {
+    case PARAM_FILTER_SAMPLES: *value = FILTER_SAMPLES; break;
+    case PARAM_MIN_STABLE_TIME_US: *value = MIN_STABLE_TIME_US; break;
+    case PARAM_DEBOUNCE_TIME_US: *value = DEBOUNCE_TIME_US; break;
+    case PARAM_MIN_LEGIT_TIME_US: *value = MIN_LEGIT_TIME_RUNTIME; break;
+    case PARAM_MAX_LEGIT_TIME_US: *value = MAX_LEGIT_TIME_RUNTIME; break;
+    default: return false;
+  }
+  return true;
+}
+
+// Same limits the text commands enforce; returns the first bad id or 0
+byte validate_params(const uint32_t *params) {
+  if(params[PARAM_FILTER_SAMPLES] < 1 || params[PARAM_FILTER_SAMPLES] > MAX_FILTER_SAMPLES)
+    return PARAM_FILTER_SAMPLES;
+  if(params[PARAM_MIN_STABLE_TIME_US] < 1000)
+    return PARAM_MIN_STABLE_TIME_US;
+  if(params[PARAM_DEBOUNCE_TIME_US] < 100)
+    return PARAM_DEBOUNCE_TIME_US;
+  if(params[PARAM_MIN_LEGIT_TIME_US] < 10000)
+    return PARAM_MIN_LEGIT_TIME_US;
+  if(params[PARAM_MAX_LEGIT_TIME_US] < params[PARAM_MIN_LEGIT_TIME_US] + 10000)
+    return PARAM_MAX_LEGIT_TIME_US;
+  return 0;
+}
+
+void send_ack(byte seq, byte status, byte param_id) {
+  byte body[2] = { status, param_id };
+  protocol.send(MSG_ACK, seq, body, sizeof(body));
+}
+
+void handle_get(byte seq, const byte *ids, byte count) {
+  byte body[FRAMED_SERIAL_MAX_PAYLOAD - 2];
+  byte *out = body;
+  if(count > sizeof(body) / 5) {
+    send_ack(seq, ACK_BAD_LENGTH, 0);
+    return;
+  }
+  for(byte i = 0; i < count; i++) {
+    uint32_t value;
+    if(!read_param(ids[i], &value)) {
+      send_ack(seq, ACK_UNKNOWN_PARAM, ids[i]);
+      return;
+    }
+    *out++ = ids[i];
+    out = FramedSerial::put_u32(out, value);
+  }
+  protocol.send(MSG_VALUES, seq, body, out - body);
+}
+
+// Stage every value, validate the combination, then apply them together
+void handle_set(byte seq, const byte *body, byte length) {
+  if(length == 0 || length % 5) {
+    send_ack(seq, ACK_BAD_LENGTH, 0);
+    return;
+  }
+
+  uint32_t params[PARAM_COUNT + 1];
+  for(byte id = 1; id <= PARAM_COUNT; id++)
+    read_param(id, &params[id]);
+
+  for(byte i = 0; i < length; i += 5) {
+    byte id = body[i];
+    if(id < 1 || id > PARAM_COUNT) {
+      send_ack(seq, ACK_UNKNOWN_PARAM, id);
+      return;
+    }
+    params[id] = FramedSerial::get_u32(body + i + 1);
+  }
+
+  byte bad = validate_params(params);
+  if(bad) {
+    send_ack(seq, ACK_BAD_VALUE, bad);
+    return;
+  }
+
+  FILTER_SAMPLES = params[PARAM_FILTER_SAMPLES];
+  MIN_STABLE_TIME_US = params[PARAM_MIN_STABLE_TIME_US];
+  DEBOUNCE_TIME_US = params[PARAM_DEBOUNCE_TIME_US];
+  MIN_LEGIT_TIME_RUNTIME = params[PARAM_MIN_LEGIT_TIME_US];
+  MAX_LEGIT_TIME_RUNTIME = params[PARAM_MAX_LEGIT_TIME_US];
+  send_ack(seq, ACK_OK, 0);
+}
+
+void handle_get_stats(byte seq) {
+  byte body[8 * 4 + 2 + 4];
+  byte *out = body;
+  out = FramedSerial::put_u32(out, receiver_stats.valid_pulses);
+  out = FramedSerial::put_u32(out, receiver_stats.rejected_pulses);
+  out = FramedSerial::put_u32(out, receiver_stats.ignored_pulses);
+  out = FramedSerial::put_u32(out, receiver_stats.sequence_resets);
+  out = FramedSerial::put_u32(out, receiver_stats.activations);
+  out = FramedSerial::put_u32(out, receiver_stats.valid_pulses ? receiver_stats.min_width_us : 0);
+  out = FramedSerial::put_u32(out, receiver_stats.max_width_us);
+  out = FramedSerial::put_u32(out, millis());
+  out = FramedSerial::put_u16(out, protocol.bad_frames());
+  out = FramedSerial::put_u32(out, cpu_active_ms());
+  protocol.send(MSG_STATS, seq, body, out - body);
+}
+
+void handle_config(byte seq, const byte *body, byte length) {
+  if(length != 1) {
+    send_ack(seq, ACK_BAD_LENGTH, 0);
+    return;
+  }
+  protocol_state.stream_pulses = body[0] & CONFIG_STREAM_PULSES;
+  console.enabled = body[0] & (CONFIG_TEXT_OUTPUT | CONFIG_TEXT_MODE);
+  send_ack(seq, ACK_OK, 0);
+  if(body[0] & CONFIG_TEXT_MODE)
+    protocol_state.active = false;
+}
+
+#ifdef ENABLE_EVENT_LOG
+#define LOG_RECORD_SIZE 7
+#define LOG_RECORDS_PER_FRAME ((FRAMED_SERIAL_MAX_PAYLOAD - 2) / LOG_RECORD_SIZE)
+
+typedef struct {
+  byte seq;
+  byte count;
+  byte body[LOG_RECORDS_PER_FRAME * LOG_RECORD_SIZE];
+} log_frame_t;
+
+log_frame_t log_frame;
+
+void send_log_frame() {
+  if(log_frame.count) {
+    protocol.send(MSG_LOG, log_frame.seq, log_frame.body, log_frame.count * LOG_RECORD_SIZE);
+    log_frame.count = 0;
+  }
+}
+
+void add_log_record(const event_record_t &record, unsigned long time_ms) {
+  byte *out = log_frame.body + log_frame.count * LOG_RECORD_SIZE;
+  *out++ = record.type;
+  out = FramedSerial::put_u32(out, time_ms);
+  FramedSerial::put_u16(out, record.value);
+  if(++log_frame.count == LOG_RECORDS_PER_FRAME)
+    send_log_frame();
+}
+
+void handle_dump_log(byte seq) {
+  log_frame.seq = seq;
+  log_frame.count = 0;
+  event_log.dump(add_log_record);
+  send_log_frame();
+  send_ack(seq, ACK_OK, 0);
+}
+#endif
+
+void process_protocol() {
+  while(protocol_state.active && protocol.poll()) {
+    switch(protocol.type()) {
+      case MSG_GET: handle_get(protocol.seq(), protocol.body(), protocol.body_length()); break;
+      case MSG_SET: handle_set(protocol.seq(), protocol.body(), protocol.body_length()); break;
+      case MSG_GET_STATS: handle_get_stats(protocol.seq()); break;
+      case MSG_CONFIG: handle_config(protocol.seq(), protocol.body(), protocol.body_length()); break;
+#ifdef ENABLE_EVENT_LOG
+      case MSG_DUMP_LOG: handle_dump_log(protocol.seq()); break;
+#endif
+      default: send_ack(protocol.seq(), ACK_UNKNOWN_TYPE, protocol.type()); break;
+    }
+  }
+}
+
+void send_pulse_event(unsigned long width_us, unsigned long interval_ms, byte result, byte pulse_count) {
+  if(!protocol_state.active || !protocol_state.stream_pulses)
+    return;
+  byte body[10];
+  byte *out = body;
+  out = FramedSerial::put_u32(out, width_us);
+  out = FramedSerial::put_u32(out, interval_ms);
+  *out++ = result;
+  *out++ = pulse_count;
+  protocol.send(MSG_PULSE, protocol_state.event_seq++, body, out - body);
+}
+#endif
 
 // Simple tuning interface
+// All text stays in flash via F(); values are printed separately so no
+// String temporaries are built on the heap
+void print_ms(const __FlashStringHelper *label, unsigned long time_us) {
+  console.print(label);
+  console.print(time_us / 1000);
+  console.println(F("ms"));
+}
+
+void print_menu_ms(const __FlashStringHelper *label, unsigned long time_us) {
+  console.print(label);
+  console.print(F(" (currently "));
+  console.print(time_us / 1000);
+  console.println(F("ms)"));
+}
+
+void print_filter_samples(const __FlashStringHelper *label) {
+  console.print(label);
+  console.print(FILTER_SAMPLES);
+  console.println(F(" (1=loose, 9=strict)"));
+}
+
 void print_tuning_menu() {
-  Serial.println("\n=== FILTER TUNING MENU ===");
-  Serial.println("Commands:");
-  Serial.println("1-9: Set filter samples (1=very loose, 9=very strict)");
-  Serial.println("a/A: Decrease/Increase min stable time (currently " + String(MIN_STABLE_TIME_US/1000) + "ms)");
-  Serial.println("b/B: Decrease/Increase debounce time (currently " + String(DEBOUNCE_TIME_US/1000) + "ms)");
-  Serial.println("c/C: Decrease/Increase min pulse width (currently " + String(MIN_LEGIT_TIME_RUNTIME/1000) + "ms)");
-  Serial.println("d/D: Decrease/Increase max pulse width (currently " + String(MAX_LEGIT_TIME_RUNTIME/1000) + "ms)");
-  Serial.println("s: Show current settings");
-  Serial.println("h: Show this menu");
-  Serial.println("============================\n");
+  console.println(F("\n=== FILTER TUNING MENU ==="));
+  console.println(F("Commands:"));
+  console.println(F("1-9: Set filter samples (1=very loose, 9=very strict)"));
+  print_menu_ms(F("a/A: Decrease/Increase min stable time"), MIN_STABLE_TIME_US);
+  print_menu_ms(F("b/B: Decrease/Increase debounce time"), DEBOUNCE_TIME_US);
+  print_menu_ms(F("c/C: Decrease/Increase min pulse width"), MIN_LEGIT_TIME_RUNTIME);
+  print_menu_ms(F("d/D: Decrease/Increase max pulse width"), MAX_LEGIT_TIME_RUNTIME);
+  console.println(F("s: Show current settings"));
+  console.println(F("m: Show RAM usage"));
+  console.println(F("p: Show CPU duty cycle"));
+#ifdef ENABLE_RF_SURVEY
+  console.println(F("v: Start/stop RF survey"));
+#endif
+#ifdef ENABLE_EVENT_LOG
+  console.println(F("l: Dump event log"));
+#endif
+  console.println(F("h: Show this menu"));
+  console.println(F("============================\n"));
 }
 
 void process_tuning_command() {
+#ifdef ENABLE_BINARY_PROTOCOL
+  if(!protocol_state.active && Serial.peek() == 0) {
+    protocol_state.active = true;
+    console.enabled = false;
+  }
+  if(protocol_state.active) {
+    process_protocol();
+    return;
+  }
+#endif
+
   if(Serial.available()) {
     char cmd = Serial.read();
     
@@ -57,54 +1063,74 @@ void process_tuning_command() {
       case '1': case '2': case '3': case '4': case '5': 
       case '6': case '7': case '8': case '9':
         FILTER_SAMPLES = cmd - '0';
-        Serial.println("Filter samples set to: " + String(FILTER_SAMPLES) + " (1=loose, 9=strict)");
+        print_filter_samples(F("Filter samples set to: "));
         break;
         
       case 'a':
         MIN_STABLE_TIME_US = max(1000UL, MIN_STABLE_TIME_US - 1000);
-        Serial.println("Min stable time: " + String(MIN_STABLE_TIME_US/1000) + "ms");
+        print_ms(F("Min stable time: "), MIN_STABLE_TIME_US);
         break;
       case 'A':
         MIN_STABLE_TIME_US += 1000;
-        Serial.println("Min stable time: " + String(MIN_STABLE_TIME_US/1000) + "ms");
+        print_ms(F("Min stable time: "), MIN_STABLE_TIME_US);
         break;
         
       case 'b':
         DEBOUNCE_TIME_US = max(100UL, DEBOUNCE_TIME_US - 100);
-        Serial.println("Debounce time: " + String(DEBOUNCE_TIME_US/1000) + "ms");
+        print_ms(F("Debounce time: "), DEBOUNCE_TIME_US);
         break;
       case 'B':
         DEBOUNCE_TIME_US += 100;
-        Serial.println("Debounce time: " + String(DEBOUNCE_TIME_US/1000) + "ms");
+        print_ms(F("Debounce time: "), DEBOUNCE_TIME_US);
         break;
         
       case 'c':
         MIN_LEGIT_TIME_RUNTIME = max(10000UL, MIN_LEGIT_TIME_RUNTIME - 5000);
-        Serial.println("Min pulse width: " + String(MIN_LEGIT_TIME_RUNTIME/1000) + "ms");
+        print_ms(F("Min pulse width: "), MIN_LEGIT_TIME_RUNTIME);
         break;
       case 'C':
         MIN_LEGIT_TIME_RUNTIME += 5000;
-        Serial.println("Min pulse width: " + String(MIN_LEGIT_TIME_RUNTIME/1000) + "ms");
+        print_ms(F("Min pulse width: "), MIN_LEGIT_TIME_RUNTIME);
         break;
         
       case 'd':
         MAX_LEGIT_TIME_RUNTIME = max(MIN_LEGIT_TIME_RUNTIME + 10000, MAX_LEGIT_TIME_RUNTIME - 10000);
-        Serial.println("Max pulse width: " + String(MAX_LEGIT_TIME_RUNTIME/1000) + "ms");
+        print_ms(F("Max pulse width: "), MAX_LEGIT_TIME_RUNTIME);
         break;
       case 'D':
         MAX_LEGIT_TIME_RUNTIME += 10000;
-        Serial.println("Max pulse width: " + String(MAX_LEGIT_TIME_RUNTIME/1000) + "ms");
+        print_ms(F("Max pulse width: "), MAX_LEGIT_TIME_RUNTIME);
         break;
         
       case 's':
-        Serial.println("\n=== CURRENT SETTINGS ===");
-        Serial.println("Filter samples: " + String(FILTER_SAMPLES) + " (1=loose, 9=strict)");
-        Serial.println("Min stable time: " + String(MIN_STABLE_TIME_US/1000) + "ms");
-        Serial.println("Debounce time: " + String(DEBOUNCE_TIME_US/1000) + "ms");
-        Serial.println("Min pulse width: " + String(MIN_LEGIT_TIME_RUNTIME/1000) + "ms");
-        Serial.println("Max pulse width: " + String(MAX_LEGIT_TIME_RUNTIME/1000) + "ms");
-        Serial.println("=======================\n");
+        console.println(F("\n=== CURRENT SETTINGS ==="));
+        print_filter_samples(F("Filter samples: "));
+        print_ms(F("Min stable time: "), MIN_STABLE_TIME_US);
+        print_ms(F("Debounce time: "), DEBOUNCE_TIME_US);
+        print_ms(F("Min pulse width: "), MIN_LEGIT_TIME_RUNTIME);
+        print_ms(F("Max pulse width: "), MAX_LEGIT_TIME_RUNTIME);
+        console.println(F("=======================\n"));
+        break;
+        
+      case 'm':
+        print_memory_report();
+        break;
+        
+      case 'p':
+        print_duty_cycle();
+        break;
+        
+#ifdef ENABLE_RF_SURVEY
+      case 'v':
+        toggle_survey(millis());
+        break;
+#endif
+        
+#ifdef ENABLE_EVENT_LOG
+      case 'l':
+        print_event_log();
         break;
+#endif
         
       case 'h':
         print_tuning_menu();
@@ -137,34 +1163,49 @@ typedef struct {
   unsigned long last_change_time;
   unsigned long pulse_start_time;
   unsigned long last_sample_time;
-  bool raw_samples[MAX_FILTER_SAMPLES];  // Use fixed maximum size
-  int sample_index;
   bool filtered_state;
   bool last_filtered_state;
   unsigned long debounce_start_time;
   unsigned long debug_last_print_time; // Added for debug timing
+  bool live;                           // Reports rejected pulses and code bits (off in the filter harness)
 } digital_filter_t;
 
 digital_filter_t pulse_filter;
+PULSE_FILTER input_filter;
 
 // Garage door activation state variables
 typedef struct {
   unsigned long pulse_times[PULSE_SEQUENCE_COUNT];  // Timestamps of last pulses
   int pulse_count;                                  // Number of pulses detected in sequence
   bool garage_door_active;                         // Is garage door currently activated?
-  unsigned long garage_door_start_time;           // When garage door activation started
   unsigned long last_valid_pulse_time;            // Timestamp of last valid pulse
-  unsigned long ignore_until_time;                // Ignore pulses until this time (dead time)
 } garage_door_state_t;
 
 garage_door_state_t garage_door_state;
 
+// The relay timer releases the door, the dead time timer being armed is
+// the dead time, and the sequence timer forgets a sequence whose next
+// pulse can no longer arrive on time
+timer_id_t relay_timer;
+timer_id_t dead_time_timer;
+timer_id_t sequence_timer;
+timer_id_t led_timer;
+byte led_toggles_left;                            // LED pattern steps still to run
+
+// The loop services timers before it processes pulses, so the sequence
+// timer runs one ms after the window closes: a pulse exactly
+// PULSE_SEQUENCE_INTERVAL + PULSE_TIMING_TOLERANCE after the last still counts
+#define SEQUENCE_EXPIRY_MS (PULSE_SEQUENCE_INTERVAL + PULSE_TIMING_TOLERANCE + 1)
+
 #ifdef ENABLE_DISPLAY
 #define FIRST_DISPLAY 0x70
 #define LAST_DISPLAY  0x77
 #define MAX_DISPLAYS  8
 
 int count_displays(){
+#ifdef HT16K33Disp_NO_I2C
+  return 1;         // Display bench: nothing on the bus, scroll on one display
+#endif
   int num_devices = 0;
   for (byte address = FIRST_DISPLAY; address <= LAST_DISPLAY; address++) {
     Wire.beginTransmission(address);
@@ -176,31 +1217,24 @@ int count_displays(){
 #endif
 
 // Initialize the digital filter
-void init_digital_filter() {
-  pulse_filter.state = FILTER_IDLE;
-  pulse_filter.last_state = FILTER_IDLE;
-  pulse_filter.last_change_time = 0;
-  pulse_filter.pulse_start_time = 0;
-  pulse_filter.last_sample_time = 0;
-  pulse_filter.sample_index = 0;
-  pulse_filter.filtered_state = false;
-  pulse_filter.last_filtered_state = false;
-  pulse_filter.debounce_start_time = 0;
-  pulse_filter.debug_last_print_time = 0;
-  
-  // Initialize sample buffer with false values
-  for(int i = 0; i < MAX_FILTER_SAMPLES; i++) {
-    pulse_filter.raw_samples[i] = false;
-  }
+void init_digital_filter(digital_filter_t &filter) {
+  filter.state = FILTER_IDLE;
+  filter.last_state = FILTER_IDLE;
+  filter.last_change_time = 0;
+  filter.pulse_start_time = 0;
+  filter.last_sample_time = 0;
+  filter.filtered_state = false;
+  filter.last_filtered_state = false;
+  filter.debounce_start_time = 0;
+  filter.debug_last_print_time = 0;
+  filter.live = true;
 }
 
 // Initialize garage door state
 void init_garage_door_state() {
   garage_door_state.pulse_count = 0;
   garage_door_state.garage_door_active = false;
-  garage_door_state.garage_door_start_time = 0;
   garage_door_state.last_valid_pulse_time = 0;
-  garage_door_state.ignore_until_time = 0;
   
   // Initialize pulse times array
   for(int i = 0; i < PULSE_SEQUENCE_COUNT; i++) {
@@ -208,22 +1242,147 @@ void init_garage_door_state() {
   }
 }
 
-// Process valid pulse for garage door activation sequence
-void process_garage_door_sequence(unsigned long current_time_ms) {
-  // Check if we're in the ignore period (dead time after activation)
-  if(current_time_ms < garage_door_state.ignore_until_time) {
-    Serial.print("Pulse ignored - in dead time (");
-    Serial.print(garage_door_state.ignore_until_time - current_time_ms);
-    Serial.println("ms remaining)");
-    return;
+// Initialize receiver statistics
+void init_receiver_stats() {
+  memset(&receiver_stats, 0, sizeof(receiver_stats));
+  receiver_stats.min_width_us = (unsigned long)-1L;
+}
+
+// Count and report a pulse the filter measured outside the legit range
+void record_rejected_pulse(unsigned long pulse_width) {
+  receiver_stats.rejected_pulses++;
+#ifdef ENABLE_RF_SURVEY
+  if(survey.active)
+    survey_rejected_pulse(pulse_width);
+#endif
+#ifdef ENABLE_EVENT_LOG
+  log_rejected_pulse(pulse_width);
+#endif
+#ifdef ENABLE_BINARY_PROTOCOL
+  send_pulse_event(pulse_width, 0, PULSE_REJECTED, garage_door_state.pulse_count);
+#endif
+}
+
+// Count and report a valid pulse and what the activation sequence did with it
+void record_valid_pulse(unsigned long pulse_width, unsigned long interval_ms, sequence_result_t result) {
+  receiver_stats.valid_pulses++;
+  if(pulse_width < receiver_stats.min_width_us)
+    receiver_stats.min_width_us = pulse_width;
+  if(pulse_width > receiver_stats.max_width_us)
+    receiver_stats.max_width_us = pulse_width;
+
+  switch(result) {
+    case SEQUENCE_IGNORED: receiver_stats.ignored_pulses++; break;
+    case SEQUENCE_RESTARTED: receiver_stats.sequence_resets++; break;
+    case SEQUENCE_ACTIVATED: receiver_stats.activations++; break;
+    default: break;
   }
+
+#ifdef ENABLE_EVENT_LOG
+  event_log.add(result, event_width(pulse_width));
+#endif
+#ifdef ENABLE_BINARY_PROTOCOL
+  send_pulse_event(pulse_width, interval_ms, result, garage_door_state.pulse_count);
+#endif
+}
+
+// Check if we're in the ignore period (dead time after activation)
+bool in_dead_time(unsigned long current_time_ms) {
+  if(timers.active(dead_time_timer)) {
+    console.print(F("Pulse ignored - in dead time ("));
+    console.print(timers.remaining(dead_time_timer, current_time_ms));
+    console.println(F("ms remaining)"));
+    return true;
+  }
+  return false;
+}
+
+// Timer callbacks, run from timers.service()
+void release_garage_door(uint8_t pin, unsigned long current_time_ms) {
+  garage_door_state.garage_door_active = false;
+  digitalWrite(pin, LOW);
+#ifdef ENABLE_EVENT_LOG
+  event_log.add(EVENT_DEACTIVATED, 0);
+#endif
+  
+  console.println(F("*** GARAGE DOOR DEACTIVATED ***"));
+  console.print(F("Pin "));
+  console.print(pin);
+  console.println(F(" set LOW"));
+}
+
+void end_dead_time(uint8_t arg, unsigned long current_time_ms) {
+  console.println(F("Dead time over, listening for pulses"));
+}
+
+// Counted and logged as a reset; the late pulse, if one comes, then
+// starts a new sequence
+void expire_sequence(uint8_t arg, unsigned long current_time_ms) {
+#ifdef ENABLE_EVENT_LOG
+  event_log.add(EVENT_SEQUENCE_EXPIRED, garage_door_state.pulse_count);
+#endif
+  garage_door_state.pulse_count = 0;
+  receiver_stats.sequence_resets++;
+  console.println(F("Pulse sequence expired - no pulse in time"));
+}
+
+// Flashes the LED; the loop shows the filtered input on it again after
+void step_led_pattern(uint8_t pin, unsigned long current_time_ms) {
+  digitalWrite(pin, (led_toggles_left & 1) ? LOW : HIGH);
+  if(--led_toggles_left)
+    timers.start(led_timer, current_time_ms, LED_BLINK_MS);
+}
+
+void start_led_pattern(unsigned long current_time_ms, byte blinks) {
+  led_toggles_left = blinks * 2;
+  timers.start(led_timer, current_time_ms, 0);
+}
+
+void init_timers() {
+  timers.begin(millis());
+  relay_timer = timers.create(release_garage_door, GARAGE_DOOR_PIN);
+  dead_time_timer = timers.create(end_dead_time, 0);
+  sequence_timer = timers.create(expire_sequence, 0);
+  led_timer = timers.create(step_led_pattern, LED_PIN);
+}
+
+void activate_garage_door(unsigned long current_time_ms) {
+  garage_door_state.garage_door_active = true;
+  garage_door_state.pulse_count = 0; // Reset for next sequence
+  timers.cancel(sequence_timer);
+  
+  // Release the door after GARAGE_DOOR_ACTIVE_TIME and ignore pulses until
+  // the dead time is over; both are wrap-safe across the millis() rollover
+  timers.start(relay_timer, current_time_ms, GARAGE_DOOR_ACTIVE_TIME);
+  timers.start(dead_time_timer, current_time_ms, GARAGE_DOOR_IGNORE_TIME);
+  
+  digitalWrite(GARAGE_DOOR_PIN, HIGH);
+  start_led_pattern(current_time_ms, ACTIVATION_BLINKS);
+  
+  console.println(F("*** GARAGE DOOR ACTIVATED! ***"));
+  console.print(F("Pin "));
+  console.print(GARAGE_DOOR_PIN);
+  console.print(F(" set HIGH for "));
+  console.print(GARAGE_DOOR_ACTIVE_TIME);
+  console.println(F(" ms"));
+  console.print(F("Pulses will be ignored for "));
+  console.print(GARAGE_DOOR_IGNORE_TIME);
+  console.println(F(" ms to prevent double-activation"));
+}
+
+// Process valid pulse for garage door activation sequence
+sequence_result_t process_garage_door_sequence(unsigned long current_time_ms) {
+  if(in_dead_time(current_time_ms))
+    return SEQUENCE_IGNORED;
   
   // Check if this pulse is part of a valid sequence
   bool is_sequence_pulse = false;
+  sequence_result_t result = SEQUENCE_ADVANCED;
   
   if(garage_door_state.pulse_count == 0) {
     // First pulse in potential sequence
     is_sequence_pulse = true;
+    result = SEQUENCE_STARTED;
   } else {
     // Check if this pulse is approximately 1000ms after the last one
     unsigned long time_since_last = current_time_ms - garage_door_state.last_valid_pulse_time;
@@ -236,7 +1395,8 @@ void process_garage_door_sequence(unsigned long current_time_ms) {
       // Timing is off, reset sequence and start over
       garage_door_state.pulse_count = 0;
       is_sequence_pulse = true; // This could be the start of a new sequence
-      Serial.println("Pulse sequence reset - timing off");
+      result = SEQUENCE_RESTARTED;
+      console.println(F("Pulse sequence reset - timing off"));
     }
   }
   
@@ -246,100 +1406,162 @@ void process_garage_door_sequence(unsigned long current_time_ms) {
     garage_door_state.pulse_count++;
     garage_door_state.last_valid_pulse_time = current_time_ms;
     
-    Serial.print("Valid pulse ");
-    Serial.print(garage_door_state.pulse_count);
-    Serial.print(" of ");
-    Serial.print(PULSE_SEQUENCE_COUNT);
-    Serial.println(" in sequence");
+    console.print(F("Valid pulse "));
+    console.print(garage_door_state.pulse_count);
+    console.print(F(" of "));
+    console.print(PULSE_SEQUENCE_COUNT);
+    console.println(F(" in sequence"));
     
     // Check if we have completed the sequence
     if(garage_door_state.pulse_count >= PULSE_SEQUENCE_COUNT) {
       // Activate garage door!
-      garage_door_state.garage_door_active = true;
-      garage_door_state.garage_door_start_time = current_time_ms;
-      garage_door_state.pulse_count = 0; // Reset for next sequence
-      
-      // Set ignore period - garage door will ignore pulses for the next 2 seconds
-      garage_door_state.ignore_until_time = current_time_ms + GARAGE_DOOR_IGNORE_TIME;
-      
-      digitalWrite(GARAGE_DOOR_PIN, HIGH);
-      
-      Serial.println("*** GARAGE DOOR ACTIVATED! ***");
-      Serial.print("Pin ");
-      Serial.print(GARAGE_DOOR_PIN);
-      Serial.print(" set HIGH for ");
-      Serial.print(GARAGE_DOOR_ACTIVE_TIME);
-      Serial.println(" ms");
-      Serial.print("Pulses will be ignored for ");
-      Serial.print(GARAGE_DOOR_IGNORE_TIME);
-      Serial.println(" ms to prevent double-activation");
+      activate_garage_door(current_time_ms);
+      result = SEQUENCE_ACTIVATED;
+    } else {
+      // Forget the sequence if the next pulse misses its window
+      timers.start(sequence_timer, current_time_ms, SEQUENCE_EXPIRY_MS);
     }
   }
+
+  return result;
 }
 
-// Update garage door activation state
-void update_garage_door_state(unsigned long current_time_ms) {
-  if(garage_door_state.garage_door_active) {
-    // Check if it's time to deactivate
-    if(current_time_ms - garage_door_state.garage_door_start_time >= GARAGE_DOOR_ACTIVE_TIME) {
-      garage_door_state.garage_door_active = false;
-      digitalWrite(GARAGE_DOOR_PIN, LOW);
-      
-      Serial.println("*** GARAGE DOOR DEACTIVATED ***");
-      Serial.print("Pin ");
-      Serial.print(GARAGE_DOOR_PIN);
-      Serial.println(" set LOW");
-    }
+#ifdef ENABLE_AUTH_CODES
+void reject_code(byte reason) {
+  console.print(F("Code word rejected, reason "));
+  console.print(reason);
+  console.print(F(" after "));
+  console.print(code_capture.bit_count);
+  console.println(F(" bits"));
+#ifdef ENABLE_EVENT_LOG
+  event_log.add(EVENT_AUTH_REJECTED, ((uint16_t)reason << 8) | code_capture.bit_count);
+#endif
+}
+
+void start_code_capture(unsigned long current_time_us) {
+  memset(code_capture.code, 0, sizeof(code_capture.code));
+  code_capture.bit_count = 0;
+  code_capture.last_bit_time = current_time_us;
+  code_capture.active = true;
+}
+
+// In authenticated mode a valid pulse only opens the way for a code word
+sequence_result_t process_sync_pulse(unsigned long current_time_ms, unsigned long current_time_us) {
+  if(in_dead_time(current_time_ms))
+    return SEQUENCE_IGNORED;
+  sequence_result_t result = code_capture.active ? SEQUENCE_RESTARTED : SEQUENCE_STARTED;
+  start_code_capture(current_time_us);
+  return result;
+}
+
+// Called by the filter for pulses outside the legit range; returns false
+// if the pulse is not part of a code word and counts as rejected
+bool capture_code_bit(unsigned long pulse_width, unsigned long current_time_us) {
+  if(!code_capture.active)
+    return false;
+  if(pulse_width < AUTH_BIT_MIN_US || pulse_width > AUTH_BIT_MAX_US) {
+    code_capture.active = false;
+    reject_code(AUTH_REJECT_BAD_BIT);
+    return false;
+  }
+
+  if(pulse_width >= AUTH_BIT_THRESHOLD_US)
+    code_capture.code[code_capture.bit_count >> 3] |= 1 << (code_capture.bit_count & 7);
+  code_capture.bit_count++;
+  code_capture.last_bit_time = current_time_us;
+
+  if(code_capture.bit_count == AUTH_CODE_BITS) {
+    code_capture.active = false;
+    // only the window check runs here, the MAC rounds are spread over loop passes
+    auth_result_t result = auth_code.verify_begin(code_capture.code);
+    if(result == AUTH_BUSY)
+      code_capture.verifying = true;
+    else
+      reject_code(result);
+  }
+  return true;
+}
+
+// Called every loop pass: persists an accepted counter, times out a stalled
+// code word and runs a few rounds of a MAC in progress
+void service_auth_code(unsigned long current_time_ms, unsigned long current_time_us) {
+  auth_code.service();
+
+  if(code_capture.active && current_time_us - code_capture.last_bit_time >= AUTH_BIT_TIMEOUT_US) {
+    code_capture.active = false;
+    // a sync pulse with no bits after it is just a stray pulse
+    if(code_capture.bit_count > 0)
+      reject_code(AUTH_REJECT_TIMEOUT);
   }
+
+  if(!code_capture.verifying)
+    return;
+#ifdef ENABLE_CYCLE_BENCH
+  bench_auth.begin();
+#endif
+  auth_result_t result = auth_code.verify_step();
+#ifdef ENABLE_CYCLE_BENCH
+  bench_auth.end();
+#endif
+  if(result == AUTH_BUSY)
+    return;
+  code_capture.verifying = false;
+
+  if(result != AUTH_OK) {
+    reject_code(result);
+    return;
+  }
+  console.print(F("Code word accepted, counter "));
+  console.println(auth_code.counter());
+  receiver_stats.activations++;
+#ifdef ENABLE_EVENT_LOG
+  event_log.add(EVENT_AUTH_ACCEPTED, auth_code.counter());
+#endif
+  activate_garage_door(current_time_ms);
 }
+#endif
 
 // Digital filter function - returns true if a valid pulse edge is detected
-bool process_digital_filter(bool raw_input, unsigned long current_time_us) {
+// The strategy turns raw samples into a level; a template rather than a
+// virtual call so the sample path inlines
+template <class Strategy>
+bool process_digital_filter(digital_filter_t &filter, Strategy &strategy, bool raw_input, unsigned long current_time_us) {
   // Sample the input at regular intervals (every 100us)
-  if(current_time_us - pulse_filter.last_sample_time >= 100) {
-    pulse_filter.last_sample_time = current_time_us;
+  if(current_time_us - filter.last_sample_time >= PULSE_FILTER_SAMPLE_US) {
+    filter.last_sample_time = current_time_us;
     
-    // Store raw sample in circular buffer
-    pulse_filter.raw_samples[pulse_filter.sample_index] = raw_input;
-    pulse_filter.sample_index = (pulse_filter.sample_index + 1) % FILTER_SAMPLES;
-    
-    // Majority vote filtering - count true samples (only use active samples)
-    int true_count = 0;
-    for(int i = 0; i < FILTER_SAMPLES; i++) {
-      if(pulse_filter.raw_samples[i]) true_count++;
-    }
-    
-    // Update filtered state based on majority vote
-    bool new_filtered_state = (true_count > FILTER_SAMPLES / 2);
+    bool new_filtered_state = strategy.sample(raw_input, current_time_us, FILTER_SAMPLES);
+#ifdef ENABLE_RF_SURVEY
+    if(survey.active && filter.live)
+      survey_sample(raw_input);
+#endif
     
     // Debug output for filter state (every 10ms to avoid spam)
     #if DEBUG_FILTER
-    if(current_time_us - pulse_filter.debug_last_print_time >= 10000) {
-      pulse_filter.debug_last_print_time = current_time_us;
-      Serial.print("Raw: ");
-      Serial.print(raw_input ? "H" : "L");
-      Serial.print(" | Votes: ");
-      Serial.print(true_count);
-      Serial.print("/");
-      Serial.print(FILTER_SAMPLES);
-      Serial.print(" | Filtered: ");
-      Serial.print(new_filtered_state ? "H" : "L");
-      Serial.print(" | State: ");
-      Serial.println(pulse_filter.state);
+    if(current_time_us - filter.debug_last_print_time >= 10000) {
+      filter.debug_last_print_time = current_time_us;
+      console.print(F("Raw: "));
+      console.print(raw_input ? 'H' : 'L');
+      console.print(F(" | Window: "));
+      console.print(FILTER_SAMPLES);
+      console.print(F(" | Filtered: "));
+      console.print(new_filtered_state ? 'H' : 'L');
+      console.print(F(" | State: "));
+      console.println(filter.state);
     }
     #endif
     
     // Store previous state for change detection
-    pulse_filter.last_state = pulse_filter.state;
+    filter.last_state = filter.state;
     
     // State machine for edge detection with hysteresis
-    switch(pulse_filter.state) {
+    switch(filter.state) {
       case FILTER_IDLE:
-        if(new_filtered_state && !pulse_filter.filtered_state) {
-          pulse_filter.state = FILTER_RISING_EDGE;
-          pulse_filter.debounce_start_time = current_time_us;
+        if(new_filtered_state && !filter.filtered_state) {
+          filter.state = FILTER_RISING_EDGE;
+          filter.debounce_start_time = current_time_us;
           #if DEBUG_STATE_CHANGES
-          Serial.println("State: IDLE -> RISING_EDGE");
+          console.println(F("State: IDLE -> RISING_EDGE"));
           #endif
         }
         break;
@@ -347,30 +1569,30 @@ bool process_digital_filter(bool raw_input, unsigned long current_time_us) {
       case FILTER_RISING_EDGE:
         if(new_filtered_state) {
           // Check if we've been stable high long enough
-          if(current_time_us - pulse_filter.debounce_start_time >= MIN_STABLE_TIME_US) {
-            pulse_filter.state = FILTER_HIGH_STABLE;
-            pulse_filter.pulse_start_time = current_time_us;
+          if(current_time_us - filter.debounce_start_time >= MIN_STABLE_TIME_US) {
+            filter.state = FILTER_HIGH_STABLE;
+            filter.pulse_start_time = current_time_us;
             #if DEBUG_STATE_CHANGES
-            Serial.print("State: RISING_EDGE -> HIGH_STABLE (pulse start: ");
-            Serial.print(pulse_filter.pulse_start_time);
-            Serial.println(")");
+            console.print(F("State: RISING_EDGE -> HIGH_STABLE (pulse start: "));
+            console.print(filter.pulse_start_time);
+            console.println(F(")"));
             #endif
           }
         } else {
           // False trigger, go back to idle
-          pulse_filter.state = FILTER_IDLE;
+          filter.state = FILTER_IDLE;
           #if DEBUG_STATE_CHANGES
-          Serial.println("State: RISING_EDGE -> IDLE (false trigger)");
+          console.println(F("State: RISING_EDGE -> IDLE (false trigger)"));
           #endif
         }
         break;
         
       case FILTER_HIGH_STABLE:
         if(!new_filtered_state) {
-          pulse_filter.state = FILTER_FALLING_EDGE;
-          pulse_filter.debounce_start_time = current_time_us;
+          filter.state = FILTER_FALLING_EDGE;
+          filter.debounce_start_time = current_time_us;
           #if DEBUG_STATE_CHANGES
-          Serial.println("State: HIGH_STABLE -> FALLING_EDGE");
+          console.println(F("State: HIGH_STABLE -> FALLING_EDGE"));
           #endif
         }
         break;
@@ -378,81 +1600,427 @@ bool process_digital_filter(bool raw_input, unsigned long current_time_us) {
       case FILTER_FALLING_EDGE:
         if(!new_filtered_state) {
           // Check if we've been stable low long enough
-          if(current_time_us - pulse_filter.debounce_start_time >= MIN_STABLE_TIME_US) {
-            pulse_filter.state = FILTER_LOW_STABLE;
+          if(current_time_us - filter.debounce_start_time >= MIN_STABLE_TIME_US) {
+            filter.state = FILTER_LOW_STABLE;
             
             // Calculate pulse width and validate
-            unsigned long pulse_width = current_time_us - pulse_filter.pulse_start_time;
+            unsigned long pulse_width = current_time_us - filter.pulse_start_time;
             
             #if DEBUG_PULSE_WIDTH
-            Serial.print("Pulse width measured: ");
-            Serial.print(pulse_width);
-            Serial.print(" us (");
-            Serial.print(pulse_width / 1000);
-            Serial.print(" ms) | Valid range: ");
-            Serial.print(MIN_LEGIT_TIME_RUNTIME / 1000);
-            Serial.print("-");
-            Serial.print(MAX_LEGIT_TIME_RUNTIME / 1000);
-            Serial.print(" ms | ");
+            console.print(F("Pulse width measured: "));
+            console.print(pulse_width);
+            console.print(F(" us ("));
+            console.print(pulse_width / 1000);
+            console.print(F(" ms) | Valid range: "));
+            console.print(MIN_LEGIT_TIME_RUNTIME / 1000);
+            console.print(F("-"));
+            console.print(MAX_LEGIT_TIME_RUNTIME / 1000);
+            console.print(F(" ms | "));
             #endif
             
             if(pulse_width >= MIN_LEGIT_TIME_RUNTIME && pulse_width <= MAX_LEGIT_TIME_RUNTIME) {
               // Valid pulse detected - return true to indicate pulse end
-              pulse_filter.state = FILTER_IDLE;
-              pulse_filter.filtered_state = false;
+              filter.state = FILTER_IDLE;
+              filter.filtered_state = false;
               #if DEBUG_PULSE_WIDTH
-              Serial.println("VALID PULSE!");
+              console.println(F("VALID PULSE!"));
               #endif
               #if DEBUG_STATE_CHANGES
-              Serial.println("State: FALLING_EDGE -> IDLE (valid pulse)");
+              console.println(F("State: FALLING_EDGE -> IDLE (valid pulse)"));
               #endif
               return true;
             } else {
               // Invalid pulse width - ignore
-              pulse_filter.state = FILTER_IDLE;
+              filter.state = FILTER_IDLE;
+#ifdef ENABLE_AUTH_CODES
+              // unless it is a bit of the code word being received
+              if(filter.live && capture_code_bit(pulse_width, current_time_us)) {
+                filter.filtered_state = new_filtered_state;
+                return false;
+              }
+#endif
+              if(filter.live)
+                record_rejected_pulse(pulse_width);
               #if DEBUG_PULSE_WIDTH
-              Serial.println("INVALID PULSE (out of range)");
+              console.println(F("INVALID PULSE (out of range)"));
               #endif
               #if DEBUG_STATE_CHANGES
-              Serial.println("State: FALLING_EDGE -> IDLE (invalid pulse width)");
+              console.println(F("State: FALLING_EDGE -> IDLE (invalid pulse width)"));
               #endif
             }
           }
         } else {
           // Still high, go back to stable high
-          pulse_filter.state = FILTER_HIGH_STABLE;
+          filter.state = FILTER_HIGH_STABLE;
           #if DEBUG_STATE_CHANGES
-          Serial.println("State: FALLING_EDGE -> HIGH_STABLE (still high)");
+          console.println(F("State: FALLING_EDGE -> HIGH_STABLE (still high)"));
           #endif
         }
         break;
         
       case FILTER_LOW_STABLE:
         if(new_filtered_state) {
-          pulse_filter.state = FILTER_RISING_EDGE;
-          pulse_filter.debounce_start_time = current_time_us;
+          filter.state = FILTER_RISING_EDGE;
+          filter.debounce_start_time = current_time_us;
           #if DEBUG_STATE_CHANGES
-          Serial.println("State: LOW_STABLE -> RISING_EDGE");
+          console.println(F("State: LOW_STABLE -> RISING_EDGE"));
           #endif
         } else {
           // Check if we've been low long enough to go back to idle
-          if(current_time_us - pulse_filter.debounce_start_time >= DEBOUNCE_TIME_US) {
-            pulse_filter.state = FILTER_IDLE;
+          if(current_time_us - filter.debounce_start_time >= DEBOUNCE_TIME_US) {
+            filter.state = FILTER_IDLE;
             #if DEBUG_STATE_CHANGES
-            Serial.println("State: LOW_STABLE -> IDLE");
+            console.println(F("State: LOW_STABLE -> IDLE"));
             #endif
           }
         }
         break;
     }
     
-    pulse_filter.filtered_state = new_filtered_state;
+    filter.filtered_state = new_filtered_state;
   }
   
   return false; // No valid pulse edge detected
 }
 
 
+#ifdef ENABLE_FILTER_HARNESS
+// Side-by-side filter comparison (built by nanoatmega328new_filter_bench)
+// Every strategy gets its own copy of the edge state machine and the same
+// pseudo-random traces, in simulated time so the run is quick under simavr.
+// Reports cycles per sample, RAM, and how many of the legit pulses were
+// found versus how many pulses were reported that were not there
+#define HARNESS_PULSES 16               // Legit pulses per trace
+#define HARNESS_PULSE_US 150000UL
+#define HARNESS_PERIOD_US 350000UL
+#define HARNESS_DETECT_WINDOW_US 20000UL  // Pulse end to detection
+#define HARNESS_DECOY_AT_US 200000UL    // Noise burst in the gap...
+#define HARNESS_DECOY_US 100000UL       // ...as long as a legit pulse
+#define HARNESS_SEED 0x2545F491UL
+
+typedef struct {
+  const char *name;
+  uint16_t spike_per_1024;      // Chance per gap sample of a spike starting
+  byte spike_max_samples;
+  uint16_t dropout_per_1024;    // Chance per pulse sample of a dropout starting
+  byte dropout_max_samples;
+  byte decoy_duty_per_256;      // Duty of the noise burst in each gap, 0 = none
+} harness_trace_t;
+
+const harness_trace_t harness_traces[] = {
+  { "clean", 0, 1, 0, 1, 0 },
+  { "glitches", 20, 3, 20, 3, 0 },
+  { "bursts", 5, 20, 5, 10, 150 },
+};
+#define HARNESS_TRACES (sizeof(harness_traces) / sizeof(harness_traces[0]))
+
+typedef struct {
+  uint32_t rng;
+  byte burst_left;      // Samples left of the current spike or dropout
+} trace_state_t;
+
+uint32_t harness_random(trace_state_t &state) {
+  state.rng ^= state.rng << 13;
+  state.rng ^= state.rng >> 17;
+  state.rng ^= state.rng << 5;
+  return state.rng;
+}
+
+bool trace_sample(const harness_trace_t &trace, trace_state_t &state, unsigned long phase_us) {
+  bool in_pulse = phase_us < HARNESS_PULSE_US;
+  if(state.burst_left) {
+    state.burst_left--;
+    return !in_pulse;
+  }
+  uint32_t r = harness_random(state);
+  if(trace.decoy_duty_per_256 && phase_us >= HARNESS_DECOY_AT_US && phase_us < HARNESS_DECOY_AT_US + HARNESS_DECOY_US)
+    return (r & 0xFF) < trace.decoy_duty_per_256;
+  uint16_t chance = in_pulse ? trace.dropout_per_1024 : trace.spike_per_1024;
+  if(chance && (r & 0x3FF) < chance) {
+    state.burst_left = (r >> 10) % (in_pulse ? trace.dropout_max_samples : trace.spike_max_samples);
+    return !in_pulse;
+  }
+  return in_pulse;
+}
+
+template <class Strategy>
+bool harness_run_strategy(CycleBench &bench) {
+  for(byte t = 0; t < HARNESS_TRACES; t++) {
+    const harness_trace_t &trace = harness_traces[t];
+    digital_filter_t filter;
+    init_digital_filter(filter);
+    filter.live = false;
+    Strategy strategy;
+    strategy.reset();
+    trace_state_t state = { HARNESS_SEED, 0 };
+    unsigned long now_us = 0;
+    unsigned int detected = 0, false_triggers = 0;
+
+    for(byte pulse = 0; pulse < HARNESS_PULSES; pulse++) {
+      bool found = false;
+      for(unsigned long phase_us = 0; phase_us < HARNESS_PERIOD_US; phase_us += PULSE_FILTER_SAMPLE_US) {
+        now_us += PULSE_FILTER_SAMPLE_US;
+        bool raw = trace_sample(trace, state, phase_us);
+        bench.begin();
+        bool valid = process_digital_filter(filter, strategy, raw, now_us);
+        bench.end();
+        if(!valid)
+          continue;
+        if(!found && phase_us >= HARNESS_PULSE_US && phase_us < HARNESS_PULSE_US + HARNESS_DETECT_WINDOW_US) {
+          found = true;
+          detected++;
+        } else {
+          false_triggers++;
+        }
+      }
+    }
+
+    Serial.print(F("FILTER "));
+    Serial.print(bench.name());
+    Serial.print(F(" trace="));
+    Serial.print(trace.name);
+    Serial.print(F(" detected="));
+    Serial.print(detected);
+    Serial.print('/');
+    Serial.print(HARNESS_PULSES);
+    Serial.print(F(" false="));
+    Serial.print(false_triggers);
+    Serial.print(F(" ram="));
+    Serial.println(sizeof(Strategy));
+  }
+  return bench.report(Serial);
+}
+
+CycleBench bench_majority("MajorityVoteFilter", BENCH_BUDGET_FILTER);
+CycleBench bench_median("MedianFilter", BENCH_BUDGET_FILTER);
+CycleBench bench_integrator("IntegratorFilter", BENCH_BUDGET_FILTER);
+CycleBench bench_glitch("GlitchRejectFilter", BENCH_BUDGET_FILTER);
+
+void run_filter_harness() {
+  bool ok = true;
+  ok &= harness_run_strategy<MajorityVoteFilter>(bench_majority);
+  ok &= harness_run_strategy<MedianFilter>(bench_median);
+  ok &= harness_run_strategy<IntegratorFilter>(bench_integrator);
+  ok &= harness_run_strategy<GlitchRejectFilter>(bench_glitch);
+  Serial.println(ok ? F("BENCH RESULT OK") : F("BENCH RESULT FAIL"));
+  CycleBench::halt();
+}
+#endif
+
+#ifdef ENABLE_TIMER_CHECK
+// Timer wheel check (built by nanoatmega328new_timer_check)
+// Drives the receiver's own activation path, then a second wheel of
+// recording timers, on a virtual millis() that starts just before the
+// 32-bit wrap and is stepped 1 ms at a time (or jumped, for a stalled
+// loop). Prints a TIMER line per check and BENCH lines for the wheel calls
+#define CHECK_START_MS (0xFFFFFFFFUL - 3000)  // Activation 1 s before the wrap
+#define CHECK_TIMERS 4
+#define CHECK_PERIODIC_MS 7
+#define CHECK_PERIODIC_RUNS 20
+
+CycleBench bench_check_service("timer_service", BENCH_BUDGET_TIMERS);
+CycleBench bench_check_start("timer_start", 0);
+CycleBench bench_check_cancel("timer_cancel", 0);
+
+TimerWheel check_wheel;
+unsigned long check_now;
+unsigned long check_fired_at[CHECK_TIMERS];
+byte check_fired[CHECK_TIMERS];
+
+void check_record(uint8_t arg, unsigned long now) {
+  check_fired_at[arg] = now;
+  check_fired[arg]++;
+}
+
+// Restarts itself, like an LED pattern
+void check_periodic(uint8_t arg, unsigned long now) {
+  check_record(arg, now);
+  if(check_fired[arg] < CHECK_PERIODIC_RUNS)
+    check_wheel.start(arg, now, CHECK_PERIODIC_MS);
+}
+
+void check_reset(unsigned long now) {
+  check_now = now;
+  check_wheel.begin(now);
+  memset(check_fired, 0, sizeof(check_fired));
+}
+
+// Steps the virtual clock to until, servicing the wheel every ms
+void check_step_to(TimerWheel &wheel, unsigned long until) {
+  while(check_now != until) {
+    check_now++;
+    bench_check_service.begin();
+    wheel.service(check_now);
+    bench_check_service.end();
+  }
+}
+
+bool check_report(const __FlashStringHelper *name, bool ok) {
+  Serial.print(F("TIMER "));
+  Serial.print(name);
+  Serial.println(ok ? F(" OK") : F(" FAIL"));
+  return ok;
+}
+
+// Three pulses ending 1 s before the wrap: the relay release, dead time
+// and LED pattern all run across it. The old ignore_until_time compare let
+// a pulse right after the activation through here
+bool check_activation() {
+  bool ok = true;
+  check_now = CHECK_START_MS;
+  timers.begin(check_now);
+  init_garage_door_state();
+  ok &= process_garage_door_sequence(check_now) == SEQUENCE_STARTED;
+  check_step_to(timers, check_now + PULSE_SEQUENCE_INTERVAL);
+  ok &= process_garage_door_sequence(check_now) == SEQUENCE_ADVANCED;
+  check_step_to(timers, check_now + PULSE_SEQUENCE_INTERVAL);
+  ok &= process_garage_door_sequence(check_now) == SEQUENCE_ACTIVATED;
+  unsigned long activated = check_now;
+
+  check_step_to(timers, activated + 500);
+  ok &= process_garage_door_sequence(check_now) == SEQUENCE_IGNORED;
+  check_step_to(timers, activated + GARAGE_DOOR_ACTIVE_TIME - 1);
+  ok &= garage_door_state.garage_door_active;
+  check_step_to(timers, activated + GARAGE_DOOR_ACTIVE_TIME + TIMER_WHEEL_TICK_MS);
+  ok &= !garage_door_state.garage_door_active;
+  ok &= !timers.active(led_timer) && led_toggles_left == 0;
+  check_step_to(timers, activated + GARAGE_DOOR_IGNORE_TIME - 1);
+  ok &= process_garage_door_sequence(check_now) == SEQUENCE_IGNORED;
+
+  // the sequence starts again once the dead time is over, takes a pulse
+  // on the last ms of its window, then expires
+  check_step_to(timers, activated + GARAGE_DOOR_IGNORE_TIME + TIMER_WHEEL_TICK_MS);
+  ok &= process_garage_door_sequence(check_now) == SEQUENCE_STARTED;
+  check_step_to(timers, check_now + PULSE_SEQUENCE_INTERVAL + PULSE_TIMING_TOLERANCE);
+  ok &= process_garage_door_sequence(check_now) == SEQUENCE_ADVANCED;
+  check_step_to(timers, check_now + SEQUENCE_EXPIRY_MS + TIMER_WHEEL_TICK_MS);
+  ok &= garage_door_state.pulse_count == 0;
+  ok &= timers.armed() == 0;
+  return check_report(F("activation"), ok);
+}
+
+// Delays from one tick to past a whole turn, started 2 s before the wrap;
+// each timer has to run once, never early and at most one tick late
+const unsigned long check_delays[CHECK_TIMERS] = { 1, 64, 2999, 40000 };
+
+bool check_rollover() {
+  bool ok = true;
+  check_reset(CHECK_START_MS + 1000);
+  unsigned long started = check_now;
+  for(byte i = 0; i < CHECK_TIMERS; i++) {
+    bench_check_start.begin();
+    check_wheel.start(i, check_now, check_delays[i]);
+    bench_check_start.end();
+  }
+  // moving a timer and cancelling one
+  check_step_to(check_wheel, started + 50);
+  check_wheel.start(1, check_now, 100);
+  check_step_to(check_wheel, started + 100);
+  bench_check_cancel.begin();
+  check_wheel.cancel(2);
+  bench_check_cancel.end();
+  check_step_to(check_wheel, started + 41000);
+
+  for(byte i = 0; i < CHECK_TIMERS; i++) {
+    unsigned long due = i == 1 ? started + 150 : started + check_delays[i];
+    if(i == 2) {
+      ok &= check_fired[i] == 0;
+      continue;
+    }
+    ok &= check_fired[i] == 1;
+    ok &= check_fired_at[i] - due < TIMER_WHEEL_TICK_MS;
+  }
+  ok &= check_wheel.armed() == 0;
+  return check_report(F("rollover"), ok);
+}
+
+// A loop pass that comes 10 s late runs every timer that came due in the
+// meantime once, and nothing that is not due yet
+bool check_stall() {
+  bool ok = true;
+  check_reset(0xFFFFFFFFUL - 5000);
+  for(byte i = 0; i < CHECK_TIMERS - 1; i++)
+    check_wheel.start(i, check_now, 10 * (i + 1));
+  check_wheel.start(CHECK_TIMERS - 1, check_now, 15000);
+  check_now += 10000;
+  check_wheel.service(check_now);
+  for(byte i = 0; i < CHECK_TIMERS - 1; i++)
+    ok &= check_fired[i] == 1;
+  ok &= check_fired[CHECK_TIMERS - 1] == 0;
+  ok &= check_wheel.remaining(CHECK_TIMERS - 1, check_now) - 5000 < TIMER_WHEEL_TICK_MS;
+  check_now += 5000 + TIMER_WHEEL_TICK_MS;
+  check_wheel.service(check_now);
+  ok &= check_fired[CHECK_TIMERS - 1] == 1;
+  return check_report(F("stall"), ok);
+}
+
+// A timer restarting itself from its callback across the wrap
+bool check_periodic_timer() {
+  check_reset(0xFFFFFFFFUL - 70);
+  unsigned long started = check_now;
+  check_wheel.start(0, check_now, CHECK_PERIODIC_MS);
+  check_step_to(check_wheel, started + 1000);
+  unsigned long span = check_fired_at[0] - started;
+  bool ok = check_fired[0] == CHECK_PERIODIC_RUNS;
+  ok &= span >= CHECK_PERIODIC_MS * CHECK_PERIODIC_RUNS;
+  ok &= span < (CHECK_PERIODIC_MS + TIMER_WHEEL_TICK_MS) * CHECK_PERIODIC_RUNS;
+  return check_report(F("periodic"), ok);
+}
+
+void run_timer_check() {
+  bool ok = true;
+  console.enabled = false;
+  for(byte i = 0; i < CHECK_TIMERS; i++)
+    check_wheel.create(check_record, i);
+  ok &= check_activation();
+  ok &= check_rollover();
+  ok &= check_stall();
+  // timer 0 again, now restarting itself
+  check_wheel = TimerWheel();
+  check_wheel.create(check_periodic, 0);
+  ok &= check_periodic_timer();
+  ok &= bench_check_service.report(Serial);
+  ok &= bench_check_start.report(Serial);
+  ok &= bench_check_cancel.report(Serial);
+  Serial.println(ok ? F("BENCH RESULT OK") : F("BENCH RESULT FAIL"));
+  CycleBench::halt();
+}
+#endif
+
+#ifdef ENABLE_SLEEP_IDLE
+// Nothing left for the loop until RX_PIN changes: the input has been low
+// for a whole filter window, so every strategy's window is low too, and
+// no log write or code word is in progress. Pending timers wake the loop
+// themselves (wait_for_event)
+bool receiver_quiet(bool raw_input, unsigned long current_time_us) {
+  if(raw_input) {
+    sleep_state.last_high_us = current_time_us;
+    return false;
+  }
+  if(current_time_us - sleep_state.last_high_us < SLEEP_QUIET_US)
+    return false;
+  if(pulse_filter.state != FILTER_IDLE || pulse_filter.filtered_state)
+    return false;
+#ifdef ENABLE_EVENT_LOG
+  if(event_log.pending())
+    return false;
+#endif
+#ifdef ENABLE_AUTH_CODES
+  if(code_capture.active || code_capture.verifying || auth_code.writing())
+    return false;
+#endif
+#ifdef ENABLE_RF_SURVEY
+  if(survey.active)
+    return false;   // Low runs are measured too
+#endif
+#ifdef ENABLE_DISPLAY
+  return false;     // The scroll steps on every pass
+#else
+  return true;
+#endif
+}
+#endif
+
 void setup() {
   Serial.begin(115200);
 #ifdef ENABLE_DISPLAY
@@ -466,24 +2034,66 @@ void setup() {
   digitalWrite(GARAGE_DOOR_PIN, LOW);
 
   // Initialize the digital filter
-  init_digital_filter();
+  init_digital_filter(pulse_filter);
+  input_filter.reset();
+  
+  // Reserve the output and deadline timers
+  init_timers();
   
   // Initialize garage door state
   init_garage_door_state();
   
+  // Initialize receiver statistics
+  init_receiver_stats();
+  
+#ifdef ENABLE_EVENT_LOG
+  // Find the end of the EEPROM event log and record this boot
+  event_log.begin();
+#endif
+  
+#ifdef ENABLE_AUTH_CODES
+  // Load the last accepted counter; the key only stays in RAM as AuthCode's copy
+  {
+    uint8_t key[AUTH_CODE_KEY_SIZE];
+    memcpy_P(key, auth_key, sizeof(key));
+    auth_code.begin(key);
+    memset(key, 0, sizeof(key));
+  }
+  memset(&code_capture, 0, sizeof(code_capture));
+#ifdef ENABLE_CYCLE_BENCH
+  bench_sign_codes();
+#endif
+#endif
+  
+#ifdef ENABLE_CYCLE_BENCH
+  CycleBench::init();
+#ifdef ENABLE_SLEEP_IDLE
+  bench_start_stimulus();
+#endif
+#endif
+#ifdef ENABLE_SLEEP_IDLE
+  init_sleep_idle();
+#endif
+#ifdef ENABLE_FILTER_HARNESS
+  run_filter_harness();
+#endif
+#ifdef ENABLE_TIMER_CHECK
+  run_timer_check();
+#endif
+
   // Show tuning menu
   print_tuning_menu();
 
-  Serial.println("*** GARAGE DOOR RECEIVER INITIALIZED ***");
-  Serial.print("Listening for pulse sequences on pin ");
-  Serial.println(RX_PIN);
-  Serial.print("Will activate garage door on pin ");
-  Serial.print(GARAGE_DOOR_PIN);
-  Serial.print(" after ");
-  Serial.print(PULSE_SEQUENCE_COUNT);
-  Serial.print(" pulses spaced ");
-  Serial.print(PULSE_SEQUENCE_INTERVAL);
-  Serial.println("ms apart");
+  console.println(F("*** GARAGE DOOR RECEIVER INITIALIZED ***"));
+  console.print(F("Listening for pulse sequences on pin "));
+  console.println(RX_PIN);
+  console.print(F("Will activate garage door on pin "));
+  console.print(GARAGE_DOOR_PIN);
+  console.print(F(" after "));
+  console.print(PULSE_SEQUENCE_COUNT);
+  console.print(F(" pulses spaced "));
+  console.print(PULSE_SEQUENCE_INTERVAL);
+  console.println(F("ms apart"));
 
 #ifdef ENABLE_DISPLAY
   device_display_count = count_displays();
@@ -520,38 +2130,92 @@ void loop() {
   unsigned long maxtime = 0L;
   unsigned long mintime = (unsigned long)-1L;
   int sample_count = 0;
-  char buffer[20];
+  char buffer[20] = "";
 #ifdef ENABLE_DISPLAY
   bool running1 = false;
 #endif
 
   while(true){
+#ifdef ENABLE_SLEEP_IDLE
+    wait_for_event();
+    unsigned long current_time_us = sample_clock_us();
+#else
     unsigned long current_time_us = micros();
+#endif
     unsigned long current_time_ms = millis();
+#ifdef ENABLE_CYCLE_BENCH
+    if(current_time_ms >= BENCH_RUN_TIME_MS)
+      bench_report_and_halt();
+    bench_loop.begin();
+#endif
+#if defined(ENABLE_CYCLE_BENCH) && !defined(ENABLE_SLEEP_IDLE)
+    bool raw_input = bench_rx_input(current_time_us);
+#else
     bool raw_input = digitalRead(RX_PIN);
+#endif
     
     // Process tuning commands
     process_tuning_command();
     
     // Process the digital filter
-    bool valid_pulse_detected = process_digital_filter(raw_input, current_time_us);
+#ifdef ENABLE_CYCLE_BENCH
+    bench_filter.begin();
+#endif
+    bool valid_pulse_detected = process_digital_filter(pulse_filter, input_filter, raw_input, current_time_us);
+#ifdef ENABLE_CYCLE_BENCH
+    bench_filter.end();
+#endif
+    
+    // Update LED based on filtered state, unless a pattern is showing
+    if(!timers.active(led_timer))
+      digitalWrite(LED_PIN, pulse_filter.filtered_state ? HIGH : LOW);
+    
+    // Run output actions and deadlines that are due (door release etc.)
+#ifdef ENABLE_CYCLE_BENCH
+    bench_timers.begin();
+#endif
+    timers.service(current_time_ms);
+#ifdef ENABLE_CYCLE_BENCH
+    bench_timers.end();
+#endif
     
-    // Update LED based on filtered state
-    digitalWrite(LED_PIN, pulse_filter.filtered_state ? HIGH : LOW);
+#ifdef ENABLE_EVENT_LOG
+    // Trickle queued events into EEPROM without waiting on it
+    service_event_log(current_time_ms);
+#endif
     
-    // Update garage door state (handles deactivation timing)
-    update_garage_door_state(current_time_ms);
+#ifdef ENABLE_AUTH_CODES
+    // Check a received code word a few MAC rounds at a time
+    service_auth_code(current_time_ms, current_time_us);
+#endif
+    
+#ifdef ENABLE_RF_SURVEY
+    // Close survey buckets and print a line per report period
+    service_survey(current_time_ms);
+#endif
     
     // If a valid pulse was detected, process it
     if(valid_pulse_detected) {
       unsigned long pulse_width = current_time_us - pulse_filter.pulse_start_time;
       
       // Process this pulse for garage door activation sequence
-      process_garage_door_sequence(current_time_ms);
+#ifdef ENABLE_CYCLE_BENCH
+      bench_sequence.begin();
+#endif
+      unsigned long interval_ms = garage_door_state.pulse_count ? current_time_ms - garage_door_state.last_valid_pulse_time : 0;
+#ifdef ENABLE_AUTH_CODES
+      sequence_result_t result = process_sync_pulse(current_time_ms, current_time_us);
+#else
+      sequence_result_t result = process_garage_door_sequence(current_time_ms);
+#endif
+#ifdef ENABLE_CYCLE_BENCH
+      bench_sequence.end();
+#endif
+      record_valid_pulse(pulse_width, interval_ms, result);
       
       if(++sample_count > RESET_AVG_SAMPLES){
         sample_count = 1;
-        Serial.println("Resetting Bounds");
+        console.println(F("Resetting Bounds"));
         maxtime = 0L;
         mintime = (unsigned long)-1L;
       }
@@ -568,17 +2232,17 @@ void loop() {
       int rmintime = mintime / 1000L;
       int rmaxtime = maxtime / 1000L;
       
-      sprintf(buffer, "%4d%4d%4d", rdiff, rmintime, rmaxtime);
+      sprintf_P(buffer, PSTR("%4d%4d%4d"), rdiff, rmintime, rmaxtime);
       
-      Serial.print("Filtered Duration, Min, Max: ");
-      Serial.print(rdiff);
-      Serial.print(", ");
-      Serial.print(rmintime);
-      Serial.print(", ");
-      Serial.print(rmaxtime);
-      Serial.print(" (State: ");
-      Serial.print(pulse_filter.state);
-      Serial.println(")");
+      console.print(F("Filtered Duration, Min, Max: "));
+      console.print(rdiff);
+      console.print(F(", "));
+      console.print(rmintime);
+      console.print(F(", "));
+      console.print(rmaxtime);
+      console.print(F(" (State: "));
+      console.print(pulse_filter.state);
+      console.println(F(")"));
     }
       
 #ifdef ENABLE_DISPLAY
@@ -586,7 +2250,20 @@ void loop() {
       if(!running1)
       disp1->begin_scroll_string(buffer, 100, 100);
       
+#ifdef ENABLE_CYCLE_BENCH
+      bench_scroll.begin();
+#endif
       running1 = disp1->step_scroll_string(dtime);  
+#ifdef ENABLE_CYCLE_BENCH
+      bench_scroll.end();
+#endif
+#endif
+#ifdef ENABLE_SLEEP_IDLE
+      if(sleep_state.sampling && receiver_quiet(raw_input, current_time_us))
+        stop_sample_timer();
+#endif
+#ifdef ENABLE_CYCLE_BENCH
+      bench_loop.end();
 #endif
     }
 }
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Run the cycle benchmark's busy and sleep builds of src/main.cpp on the host.
+
+Builds main.cpp with ENABLE_CYCLE_BENCH for the host with g++ against
+tools/hostsim (a stand-in for the ATmega328P's timers, pin change
+interrupt, sleep and serial port, see benchsim.cpp), once as the
+nanoatmega328new_bench environment builds it and once with
+ENABLE_SLEEP_IDLE as nanoatmega328new_sleep_bench does. Each run plays the
+bench's pulse train for 8 s and prints the firmware's DUTY line: time
+awake, pulses accepted and rejected, activations and pulse widths. The two
+builds should see the same pulses.
+
+    tools/benchsim.py
+    tools/benchsim.py --builds sleep --define DEBUG_PULSE_WIDTH=1
+    tools/benchsim.py --raw
+
+Pass counts come from the CycleBench markers; cycle counts need simavr
+(scripts/cycle_bench.py).
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(TOOLS)
+HOSTSIM = os.path.join(TOOLS, "hostsim")
+BUILD_DIR = os.path.join(ROOT, "build", "benchsim")
+MAIN = os.path.join(ROOT, "src", "main.cpp")
+
+BUILDS = {"busy": [], "sleep": ["-DENABLE_SLEEP_IDLE"]}
+# faked by benchsim.cpp, the real one needs the AVR's Timer1
+NOT_ON_HOST = {"CycleBench"}
+DUTY = re.compile(r"DUTY (.*)")
+SIM = re.compile(r"SIM (.*)")
+FIELD = re.compile(r"(\w+)=(\d+)")
+
+
+def libraries(source):
+    """lib/ directories for the libraries main.cpp includes."""
+    found = []
+    for name in re.findall(r"#include\s*<(\w+)\.h>", source):
+        path = os.path.join(ROOT, "lib", name)
+        if os.path.isdir(path) and path not in found:
+            found.append(path)
+    return found
+
+
+def build(build_name, flags):
+    with open(MAIN) as f:
+        libs = libraries(f.read())
+    if not os.path.isdir(BUILD_DIR):
+        os.makedirs(BUILD_DIR)
+    out = os.path.join(BUILD_DIR, "main_" + build_name)
+    sources = [os.path.join(lib, f) for lib in libs if os.path.basename(lib) not in NOT_ON_HOST
+               for f in sorted(os.listdir(lib)) if f.endswith(".cpp")]
+    cmd = (["g++", "-O2", "-std=gnu++11", "-fpermissive", "-w", "-DENABLE_CYCLE_BENCH", "-DHT16K33Disp_NO_I2C",
+            "-I", os.path.join(HOSTSIM, "stub")] +
+           [arg for lib in libs for arg in ("-I", lib)] + flags +
+           [MAIN, os.path.join(HOSTSIM, "benchsim.cpp")] + sources + ["-o", out])
+    if subprocess.call(cmd) != 0:
+        sys.exit("build of %s failed" % build_name)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--builds", nargs="+", default=list(BUILDS), choices=list(BUILDS))
+    parser.add_argument("--define", nargs="*", default=[], help="extra main.cpp defines, e.g. DEBUG_PULSE_WIDTH=1")
+    parser.add_argument("--raw", action="store_true", help="print the firmware's whole serial output")
+    args = parser.parse_args()
+
+    extra = ["-D" + d for d in args.define]
+    for build_name in args.builds:
+        binary = build(build_name, BUILDS[build_name] + extra)
+        output = subprocess.check_output([binary], universal_newlines=True)
+        if args.raw:
+            sys.stdout.write(output)
+            continue
+        duty = DUTY.search(output)
+        sim = SIM.search(output)
+        if not duty:
+            sys.exit("%s: no DUTY line, see --raw" % build_name)
+        fields = dict(FIELD.findall(duty.group(1)))
+        if sim:
+            fields.update(FIELD.findall(sim.group(1)))
+        print("%-6s %s" % (build_name, " ".join("%s=%s" % (k, v) for k, v in fields.items())))
+
+
+if __name__ == "__main__":
+    main()
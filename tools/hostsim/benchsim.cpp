@@ -0,0 +1,210 @@
+// Host stand-in for the ATmega328P under the cycle benchmark, linked with
+// src/main.cpp built with ENABLE_CYCLE_BENCH (see tools/benchsim.py).
+//
+// Time is virtual and only moves when the firmware reads the clock, writes
+// to the serial port or sleeps, so a run is exactly repeatable:
+//  - a micros() or millis() call costs 4 us, about what the real ones take
+//    with the call around them
+//  - serial output goes into a 64-byte buffer that drains at 115200 baud
+//    (87 us a byte); a write that finds it full waits, as on the board
+//  - Timer1 counts CPU cycles for CycleBench::now(), and its compare B
+//    interrupt plays the sleep bench's pulse train onto RX_PIN
+//  - Timer2 ticks every 100 us while it is running, and a level change on
+//    RX_PIN raises the pin change interrupt while it is unmasked
+//  - sleep_cpu() skips ahead to the next interrupt, at the latest the next
+//    Timer0 overflow (every 1024 us)
+// Interrupts are held back while they are off and run as soon as they are
+// on again. The pass counts in the BENCH lines are real; the cycle counts
+// are not measured here and are left out.
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include <avr/eeprom.h>
+#include <CycleBench.h>
+
+#define MICROS_COST_US 4
+#define SERIAL_BYTE_US 87
+#define SERIAL_BUFFER 64
+#define SAMPLE_TICK_US 100
+#define TIMER0_OVERFLOW_US 1024
+#define CYCLES_PER_US (F_CPU / 1000000UL)
+#define RX_PIN 6
+
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, OCR1A, OCR1B;
+volatile uint8_t TCCR2A, TCCR2B, TIMSK2, TIFR2, OCR2A, TCNT2;
+volatile uint8_t PCICR, PCMSK2, PCIFR, SREG, SMCR, MCUSR, PRR;
+
+// main.cpp's RAM report reads these linker symbols
+uint8_t _end, __stack;
+char * __brkval;
+
+HardwareSerial Serial;
+
+#ifdef ENABLE_SLEEP_IDLE
+extern "C" void TIMER1_COMPB_vect(void);
+extern "C" void TIMER2_COMPA_vect(void);
+extern "C" void PCINT2_vect(void);
+#endif
+
+static unsigned long long t_us = 0;
+static unsigned long long serial_free_us = 0;   // when the serial buffer is empty
+static unsigned long long slept_us = 0;
+static unsigned long long next_tick_us = 0;     // next Timer2 compare, while it runs
+static bool timer2_running = false;
+static unsigned long long next_compb_cycle = 0; // next Timer1 compare B, while enabled
+static bool compb_armed = false;
+static bool rx_level = false;
+static bool pin_change_pending = false;
+static bool in_interrupt = false;
+
+static unsigned long long cycles(){ return t_us * CYCLES_PER_US; }
+
+// first cycle after now when the 16-bit count reaches OCR1B
+static unsigned long long compb_after(unsigned long long now){
+    unsigned long long next = (now & ~0xffffULL) | OCR1B;
+    return next > now ? next : next + 0x10000ULL;
+}
+
+static void run_interrupts(){
+    if(in_interrupt || sim_interrupts_off())
+        return;
+    in_interrupt = true;
+
+#ifdef ENABLE_SLEEP_IDLE
+    if((TIMSK1 & _BV(OCIE1B)) && !compb_armed){
+        compb_armed = true;
+        next_compb_cycle = compb_after(cycles());
+    }
+    if(!(TIMSK1 & _BV(OCIE1B)))
+        compb_armed = false;
+    while(compb_armed && cycles() >= next_compb_cycle){
+        unsigned long long matched = next_compb_cycle;
+        TIMER1_COMPB_vect();
+        next_compb_cycle = compb_after(matched);
+    }
+
+    if(TCCR2B && !timer2_running){
+        timer2_running = true;
+        next_tick_us = t_us + SAMPLE_TICK_US;
+    }
+    if(!TCCR2B)
+        timer2_running = false;
+    while(timer2_running && t_us >= next_tick_us){
+        next_tick_us += SAMPLE_TICK_US;
+        TIMER2_COMPA_vect();
+    }
+    if(pin_change_pending && (PCMSK2 & _BV(PCINT22))){
+        pin_change_pending = false;
+        PCINT2_vect();
+    }
+#endif
+    in_interrupt = false;
+}
+
+static void advance(unsigned long long us){
+    t_us += us;
+    run_interrupts();
+}
+
+void init(){}
+
+unsigned long micros(){ advance(MICROS_COST_US); return (unsigned long)t_us; }
+unsigned long millis(){ advance(MICROS_COST_US); return (unsigned long)(t_us / 1000); }
+void delay(unsigned long ms){ advance(ms * 1000ULL); }
+void delayMicroseconds(unsigned int us){ advance(us); }
+
+void pinMode(uint8_t, uint8_t){}
+int digitalRead(uint8_t pin){ return pin == RX_PIN ? rx_level : LOW; }
+void digitalWrite(uint8_t pin, uint8_t value){
+    if(pin != RX_PIN || (bool)value == rx_level)
+        return;
+    rx_level = value;
+    pin_change_pending = true;
+    run_interrupts();
+}
+
+long random(long howbig){ return 0; }
+long random(long howsmall, long howbig){ return howsmall; }
+
+void set_sleep_mode(int){}
+void sleep_enable(){}
+void sleep_disable(){}
+
+// sei() before sleep_cpu() lets it run, so anything due wakes it at once
+void sleep_cpu(){
+    unsigned long long wake = (t_us / TIMER0_OVERFLOW_US + 1) * TIMER0_OVERFLOW_US;
+    if(timer2_running && next_tick_us < wake)
+        wake = next_tick_us;
+    if(compb_armed && next_compb_cycle / CYCLES_PER_US < wake)
+        wake = next_compb_cycle / CYCLES_PER_US;
+    if(pin_change_pending && (PCMSK2 & _BV(PCINT22)))
+        wake = t_us;
+    if(wake > t_us){
+        slept_us += wake - t_us;
+        t_us = wake;
+    }
+    run_interrupts();
+}
+
+size_t Print::write(const uint8_t * buffer, size_t size){
+    for(size_t i = 0; i < size; i++){
+        unsigned long long start = serial_free_us > t_us ? serial_free_us : t_us;
+        if(start - t_us > SERIAL_BUFFER * SERIAL_BYTE_US)
+            advance(start - t_us - SERIAL_BUFFER * SERIAL_BYTE_US);
+        serial_free_us = start + SERIAL_BYTE_US;
+    }
+    fwrite(buffer, 1, size, stdout);
+    return size;
+}
+size_t Print::write(uint8_t c){ return write(&c, 1); }
+size_t Print::print(const char * s){ return write((const uint8_t *)s, strlen(s)); }
+size_t Print::print(const __FlashStringHelper * s){ return print((const char *)s); }
+size_t Print::print(char c){ return write((uint8_t)c); }
+size_t Print::print(int value, int base){ char s[20]; sprintf(s, base == HEX ? "%x" : "%d", value); return print(s); }
+size_t Print::print(unsigned value, int base){ char s[20]; sprintf(s, base == HEX ? "%x" : "%u", value); return print(s); }
+size_t Print::print(long value, int base){ char s[24]; sprintf(s, base == HEX ? "%lx" : "%ld", value); return print(s); }
+size_t Print::print(unsigned long value, int base){ char s[24]; sprintf(s, base == HEX ? "%lx" : "%lu", value); return print(s); }
+size_t Print::print(double value, int digits){ char s[32]; sprintf(s, "%.*f", digits, value); return print(s); }
+size_t Print::println(const char * s){ print(s); return println(); }
+size_t Print::println(const __FlashStringHelper * s){ print(s); return println(); }
+size_t Print::println(char c){ print(c); return println(); }
+size_t Print::println(int value, int base){ print(value, base); return println(); }
+size_t Print::println(unsigned value, int base){ print(value, base); return println(); }
+size_t Print::println(long value, int base){ print(value, base); return println(); }
+size_t Print::println(unsigned long value, int base){ print(value, base); return println(); }
+size_t Print::println(double value, int digits){ print(value, digits); return println(); }
+size_t Print::println(){ return print("\r\n"); }
+void HardwareSerial::begin(unsigned long){}
+int Stream::available(){ return 0; }
+int Stream::read(){ return -1; }
+int Stream::peek(){ return -1; }
+void Stream::flush(){ if(serial_free_us > t_us) advance(serial_free_us - t_us); }
+
+static uint8_t eeprom[E2END + 1];
+static struct eeprom_erased_t { eeprom_erased_t(){ memset(eeprom, 0xff, sizeof(eeprom)); } } eeprom_erased;
+uint8_t eeprom_read_byte(const uint8_t * address){ return eeprom[(size_t)address]; }
+void eeprom_update_byte(uint8_t * address, uint8_t value){ eeprom[(size_t)address] = value; }
+void eeprom_read_block(void * dest, const void * source, size_t size){ memcpy(dest, eeprom + (size_t)source, size); }
+bool eeprom_is_ready(){ return true; }
+
+// Counts passes only; Timer1 is the cycle clock above
+unsigned long CycleBench::_overhead = 0;
+CycleBench::CycleBench(const char * name, unsigned long budget){ _name = name; _budget = budget; reset(); }
+void CycleBench::init(){}
+unsigned long CycleBench::now(){ return (unsigned long)cycles(); }
+void CycleBench::begin(){}
+void CycleBench::end(){ _count++; }
+void CycleBench::reset(){ _count = 0; }
+bool CycleBench::over_budget(){ return false; }
+bool CycleBench::report(Print & out){
+    char line[64];
+    sprintf(line, "BENCH %s n=%lu", _name, _count);
+    out.println(line);
+    return true;
+}
+void CycleBench::halt(){
+    Serial.flush();
+    printf("SIM slept_ms=%llu total_ms=%llu\n", slept_us / 1000, t_us / 1000);
+    exit(0);
+}
@@ -0,0 +1,198 @@
+// Test vectors for the Python ports in tools/linksim.py, from the real
+// libraries built for the host. tools/test_linksim.py checks the ports
+// against them, and with --regenerate rebuilds this and writes each set
+// to tools/vectors/<set>.txt:
+//
+//   linkvectors link_adapt
+//   linkvectors slot_schedule
+//
+// link_adapt: each scenario drives LinkAdapt through a seeded mix of
+// ACKs, give-ups and timeout draws on one kind of link, and every call is
+// written out with its result, one per line:
+//
+//   ack <rtt_ms> <tries> = <srtt> <rttvar> <success> <rto> <retries>
+//   fail <tries> = <srtt> <rttvar> <success> <rto> <retries>
+//   timeout <attempt> <bound> <draw> = <ms>
+//
+// where the timeout's random(0, bound) returned draw.
+//
+// slot_schedule: slot_airtime_ms() for each length, then SlotMap runs
+// with clients coming and going, and SlotClock runs following a base
+// station's beacons on a drifting clock:
+//
+//   airtime <len> = <ms>
+//   map <slots> <slot_ms> <beacon_every>    a new SlotMap, base address 0
+//   heard <address> <now>
+//   due <now> = <0|1>
+//   beacon <now> = <beacon bytes>
+//   clock <address>                         a new SlotClock
+//   rx <beacon bytes> <rx_start> = <accepted> <slot> <last_error> <drift_ppm>
+//   wait <now> <need_ms> = <ms> <synced>
+//
+// The host's long is 64 bits and its int 32, so values stay in ranges
+// where the AVR's 32-bit and 16-bit arithmetic gives the same results.
+
+#include <Arduino.h>
+#include <LinkAdapt.h>
+#include <SlotSchedule.h>
+
+// ardc_send_aht20 settings, as in linksim.py
+#define TIMEOUT 1000
+#define MIN_TIMEOUT 400
+#define MAX_TIMEOUT 4000
+#define RETRIES 10
+
+static uint32_t lcg_state;
+
+static uint32_t next_rand(uint32_t bound){
+    lcg_state = lcg_state * 1664525UL + 1013904223UL;
+    return (lcg_state >> 8) % bound;
+}
+
+// LinkAdapt::timeout()'s jitter, recorded for the vector line
+static long last_bound, last_draw;
+
+long random(long howsmall, long howbig){
+    last_bound = howbig - howsmall;
+    last_draw = howsmall + next_rand(howbig - howsmall);
+    return last_draw;
+}
+long random(long howbig){ return random(0, howbig); }
+
+// SlotMap::report() links against it
+size_t Print::println(const char * s){ return printf("%s\n", s); }
+
+static void print_state(LinkAdapt & link){
+    printf(" = %u %u %u %u %u\n", link.srtt(), link.rttvar(), link.success(), link.rto(), link.retries());
+}
+
+// ack_chance out of 100 per transmission; rtts spread around rtt_ms
+static void scenario(const char * name, uint32_t seed, uint8_t ack_chance, uint16_t rtt_ms, uint16_t spread_ms,
+                     int steps){
+    LinkAdapt link(TIMEOUT, MIN_TIMEOUT, MAX_TIMEOUT, RETRIES);
+    lcg_state = seed;
+    printf("scenario %s\n", name);
+    for(int step = 0; step < steps; step++){
+        uint8_t allowed = link.retries() + 1;
+        uint8_t tries = 0;
+        bool acked = false;
+        while(tries < allowed && !acked){
+            uint16_t wait = link.timeout(tries);
+            printf("timeout %u %ld %ld = %u\n", tries, last_bound, last_draw, wait);
+            tries++;
+            acked = next_rand(100) < ack_chance;
+        }
+        if(acked){
+            uint16_t rtt = rtt_ms + next_rand(spread_ms + 1);
+            printf("ack %u %u", rtt, tries);
+            link.ack_received(rtt, tries);
+        } else {
+            printf("fail %u", tries);
+            link.send_failed(tries);
+        }
+        print_state(link);
+    }
+}
+
+static void link_adapt_vectors(){
+    printf("# lib/LinkAdapt vectors, written by tools/hostsim/linkvectors.cpp\n");
+    scenario("clean", 1, 98, 300, 80, 60);
+    scenario("lossy", 2, 70, 320, 400, 80);
+    scenario("congested", 3, 35, 350, 1500, 80);
+    scenario("dead", 4, 3, 300, 100, 40);
+    // RTTs over MAX_TIMEOUT are clamped
+    scenario("slow", 5, 90, 3500, 3000, 40);
+    scenario("jittery", 6, 60, 200, 3000, 60);
+}
+
+static void print_hex(const uint8_t * buf, uint8_t len){
+    for(uint8_t i = 0; i < len; i++)
+        printf("%02x", buf[i]);
+}
+
+// Clients come and go, so slots are handed out, kept and taken back
+static void slot_map_run(uint32_t seed, uint8_t slots, uint16_t slot_ms, uint8_t beacon_every){
+    SlotMap map(0, slots, slot_ms, beacon_every);
+    uint8_t beacon[SLOT_SCHEDULE_BEACON_SIZE];
+    unsigned long now = 0;
+    lcg_state = seed;
+    printf("map %u %u %u\n", slots, slot_ms, beacon_every);
+    for(int step = 0; step < 600; step++){
+        now += 1 + next_rand(12000);
+        // addresses 1-4 stop after the first half hour, 5-9 start at it
+        uint8_t address = 1 + next_rand(9);
+        bool active = address <= 4 ? now < 1800000UL : now >= 1800000UL;
+        if(active && next_rand(4) == 0){
+            printf("heard %u %lu\n", address, now);
+            map.heard(address, now);
+        }
+        bool due = map.beacon_due(now);
+        printf("due %lu = %u\n", now, due);
+        if(due){
+            uint8_t len = map.beacon(beacon, now);
+            printf("beacon %lu = ", now);
+            print_hex(beacon, len);
+            printf("\n");
+        }
+    }
+}
+
+// A client whose resonator runs ppm fast follows a base station's beacons,
+// some of them lost, and asks for its slot at random times
+static void slot_clock_run(uint32_t seed, uint8_t beacon_every, long ppm, uint8_t lost_percent){
+    const uint8_t address = 3;
+    SlotMap map(0, 5, 2000, beacon_every);
+    SlotClock clock(address);
+    uint8_t beacon[SLOT_SCHEDULE_BEACON_SIZE];
+    unsigned long now = 0;          // the base station's ms
+    unsigned long offset = 50000;   // the client's millis() at our 0
+    lcg_state = seed;
+    printf("clock %u\n", address);
+    for(int step = 0; step < 1000; step++){
+        now += 1 + next_rand(1200);
+        unsigned long local = offset + now + (long long)now * ppm / 1000000;
+        // the client is heard from its third minute on
+        if(now > 120000UL && next_rand(10) == 0)
+            map.heard(address, now);
+        if(map.beacon_due(now)){
+            uint8_t len = map.beacon(beacon, now);
+            if(next_rand(100) >= lost_percent){
+                bool ok = clock.beacon(beacon, len, local);
+                printf("rx ");
+                print_hex(beacon, len);
+                printf(" %lu = %u %u %d %ld\n", local, ok, clock.slot(), clock.last_error(), clock.drift_ppm());
+            }
+            continue;
+        }
+        uint16_t need = 100 + next_rand(2400);
+        printf("wait %lu %u = %lu %u\n", local, need, clock.wait(local, need), clock.synced(local));
+    }
+}
+
+static void slot_schedule_vectors(){
+    printf("# lib/SlotSchedule vectors, written by tools/hostsim/linkvectors.cpp\n");
+    for(uint8_t len = 0; len <= 20; len++)
+        printf("airtime %u = %u\n", len, slot_airtime_ms(len, 480));
+    slot_map_run(11, 5, 2000, 6);
+    slot_map_run(12, 8, 1000, 3);
+    slot_map_run(13, 3, 2500, 1);
+    slot_clock_run(21, 6, 0, 0);
+    slot_clock_run(22, 1, 5000, 30);
+    slot_clock_run(23, 1, -5000, 30);
+    // past SLOT_SCHEDULE_MAX_DRIFT_PERCENT the period is not learned
+    slot_clock_run(24, 2, 30000, 10);
+    // most beacons lost, so the client keeps dropping back to free running
+    slot_clock_run(25, 1, 2000, 80);
+}
+
+int main(int argc, char ** argv){
+    if(argc == 2 && !strcmp(argv[1], "link_adapt"))
+        link_adapt_vectors();
+    else if(argc == 2 && !strcmp(argv[1], "slot_schedule"))
+        slot_schedule_vectors();
+    else {
+        fprintf(stderr, "usage: linkvectors link_adapt|slot_schedule\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,496 @@
+// Host simulation of a datagram base station sketch against RH_ASK clients.
+//
+// The sketch (ards_receive_aht20 or ards_receive_display) and its libraries
+// are built unchanged for the host and linked with this file, which stands
+// in for the Arduino core, Wire and RadioHead. Time is virtual: every
+// micros()/millis() call costs 4 us, an I2C byte 90 us and a serial byte
+// 87 us once the 64-byte buffer is full, so a loop pass takes about as long
+// as it would on the 16 MHz board. Frames take their RH_ASK airtime at
+// 480 bps; frames that overlap are both lost, and each receiver loses a
+// frame with probability <loss>.
+//
+// Each client sends an 8-byte reading every ~10 s like ardc_send_aht20 did
+// with RHReliableDatagram: 10 retries, a 1000 ms ACK timeout plus up to
+// the same again at random, then waits up to 2 s for the reply and ACKs
+// it. A reading that comes due while the last one is still being sent is
+// dropped.
+//
+//     replysim <clients> <loss> <seed> [hours] [verbose]
+//
+// prints one line, e.g.
+//     clients=2 loss=10% readings=720 delivered=614 ... worst_pass=7 ms
+// tools/replysim.py builds the sketches and runs the grid.
+
+#include <Arduino.h>
+#include <RH_ASK.h>
+#include <RHReliableDatagram.h>
+#include <Wire.h>
+#include <random>
+#include <vector>
+
+void setup();
+void loop();
+extern int recvcount, failcount;     // the sketch's received and reply-failed counts
+
+#define SERVER_ADDRESS 2
+#define DATARATE 480
+#define READING_INTERVAL_MS 10000
+#define READING_LEN 8
+#define CLIENT_RETRIES 10
+#define CLIENT_TIMEOUT 1000
+#define CLIENT_REPLY_TIMEOUT 2000
+#define MAX_CLIENTS 8
+
+#define MICROS_COST_US 4
+#define I2C_BYTE_US 90               // 9 bits at 100 kHz
+#define SERIAL_BYTE_US 87            // 10 bits at 115200 baud
+#define SERIAL_BUFFER 64
+
+static unsigned long long t_us = 0;
+static std::mt19937 rng(1);
+static double loss = 0.1;
+static bool verbose = false;
+
+// RH_ASK airtime: preamble, header, 4b6b symbols and CRC
+static unsigned frame_ms(unsigned len){
+    return ((len + 7) * 12 + 48) * 1000 / DATARATE;
+}
+
+struct frame_t {
+    unsigned long long end;
+    int source;
+    uint8_t to, from, id, flags, len;
+    uint8_t data[RH_ASK_MAX_MESSAGE_LEN];
+    bool collided;
+};
+
+struct node_t {
+    uint8_t address;
+    unsigned long long tx_until;
+    bool rx_on;                      // RH_ASK stops receiving after a send until polled
+    bool rx_valid;
+    frame_t rx;                      // one-frame receive buffer, overwritten if unread
+    uint8_t header_id, header_flags;
+};
+
+static std::vector<frame_t> on_air;
+static std::vector<node_t> nodes;    // node 0 is the sketch
+
+static void tick();
+
+static void advance(unsigned long long us){
+    unsigned long long target = t_us + us;
+    for(unsigned long long next = (t_us / 1000 + 1) * 1000; next <= target; next += 1000){
+        t_us = next;
+        tick();
+    }
+    t_us = target;
+}
+
+static void transmit(int source, uint8_t to, const uint8_t * buf, uint8_t len){
+    node_t & node = nodes[source];
+    frame_t frame;
+    frame.end = t_us + frame_ms(len) * 1000ULL;
+    frame.source = source;
+    frame.to = to;
+    frame.from = node.address;
+    frame.id = node.header_id;
+    frame.flags = node.header_flags;
+    frame.len = len;
+    memcpy(frame.data, buf, len);
+    frame.collided = false;
+    for(auto & other : on_air){
+        if(other.end > t_us){
+            other.collided = true;
+            frame.collided = true;
+        }
+    }
+    on_air.push_back(frame);
+    node.tx_until = frame.end;
+    if(source == 0)
+        node.rx_on = false;
+}
+
+// Clients
+
+enum { CLIENT_IDLE, CLIENT_SEND, CLIENT_WAIT_TX, CLIENT_WAIT_ACK, CLIENT_WAIT_REPLY };
+
+struct client_t {
+    int node;
+    double next_reading_ms;
+    double interval_ms;
+    int state;
+    uint8_t id;
+    int tries;
+    unsigned long long deadline;
+    unsigned long timeout;
+    bool ack_owed;
+    uint8_t ack_id;
+    long readings, sent, gave_up, superseded, replies;
+};
+
+static std::vector<client_t> clients;
+
+static void client_receive(client_t & client, const frame_t & frame){
+    if(frame.from != SERVER_ADDRESS)
+        return;
+    if(frame.flags & RH_FLAGS_ACK){
+        if((client.state == CLIENT_WAIT_TX || client.state == CLIENT_WAIT_ACK) && frame.id == client.id){
+            client.state = CLIENT_WAIT_REPLY;
+            client.deadline = t_us + CLIENT_REPLY_TIMEOUT * 1000ULL;
+        }
+        return;
+    }
+    if(frame.to != nodes[client.node].address)
+        return;
+    client.ack_owed = true;
+    client.ack_id = frame.id;
+    if(client.state == CLIENT_WAIT_REPLY){
+        client.replies++;
+        client.state = CLIENT_IDLE;
+    }
+}
+
+static void client_poll(client_t & client){
+    node_t & node = nodes[client.node];
+    bool transmitting = t_us < node.tx_until;
+    if(client.state == CLIENT_WAIT_TX && !transmitting){
+        client.state = CLIENT_WAIT_ACK;
+        client.deadline = t_us + client.timeout * 1000ULL;
+    }
+    if(t_us / 1000.0 >= client.next_reading_ms){
+        client.next_reading_ms += client.interval_ms;
+        client.readings++;
+        if(client.state == CLIENT_IDLE){
+            client.state = CLIENT_SEND;
+            client.id++;
+            client.tries = 0;
+            client.sent++;
+        } else {
+            client.superseded++;
+        }
+    }
+    if(transmitting)
+        return;
+
+    if(client.ack_owed){
+        uint8_t ack = '!';
+        node.header_id = client.ack_id;
+        node.header_flags = RH_FLAGS_ACK;
+        transmit(client.node, SERVER_ADDRESS, &ack, sizeof(ack));
+        client.ack_owed = false;
+        return;
+    }
+
+    switch(client.state){
+        case CLIENT_SEND: {
+            uint8_t reading[READING_LEN] = { 0 };
+            node.header_id = client.id;
+            node.header_flags = client.tries ? RH_FLAGS_RETRY : 0;
+            transmit(client.node, SERVER_ADDRESS, reading, sizeof(reading));
+            client.timeout = CLIENT_TIMEOUT + CLIENT_TIMEOUT * (rng() % 256) / 256;
+            client.tries++;
+            client.state = CLIENT_WAIT_TX;
+            break;
+        }
+        case CLIENT_WAIT_ACK:
+            if(t_us >= client.deadline){
+                if(client.tries > CLIENT_RETRIES){
+                    client.gave_up++;
+                    client.state = CLIENT_IDLE;
+                } else {
+                    client.state = CLIENT_SEND;
+                }
+            }
+            break;
+        case CLIENT_WAIT_REPLY:
+            if(t_us >= client.deadline)
+                client.state = CLIENT_IDLE;
+            break;
+    }
+}
+
+// Delivers the frames that ended and steps the clients, once per ms
+static void tick(){
+    std::uniform_real_distribution<double> chance(0, 1);
+    for(size_t i = 0; i < on_air.size();){
+        frame_t & frame = on_air[i];
+        if(frame.end > t_us){
+            i++;
+            continue;
+        }
+        for(size_t k = 0; k < nodes.size(); k++){
+            if((int)k == frame.source || frame.collided)
+                continue;
+            if(chance(rng) < loss)
+                continue;
+            node_t & node = nodes[k];
+            if(frame.to != node.address && frame.to != RH_BROADCAST_ADDRESS)
+                continue;
+            if(k == 0){
+                if(node.rx_on){
+                    node.rx = frame;
+                    node.rx_valid = true;
+                }
+            } else {
+                for(auto & client : clients)
+                    if(client.node == (int)k)
+                        client_receive(client, frame);
+            }
+        }
+        on_air.erase(on_air.begin() + i);
+    }
+    for(auto & client : clients)
+        client_poll(client);
+}
+
+// Arduino core
+
+HardwareSerial Serial;
+TwoWire Wire;
+
+static unsigned serial_queued = 0;
+static unsigned long long serial_drained_us = 0;
+
+unsigned long micros(){ advance(MICROS_COST_US); return (unsigned long)t_us; }
+unsigned long millis(){ advance(MICROS_COST_US); return (unsigned long)(t_us / 1000); }
+void delay(unsigned long ms){ advance(ms * 1000ULL); }
+void delayMicroseconds(unsigned int us){ advance(us); }
+void pinMode(uint8_t, uint8_t){}
+void digitalWrite(uint8_t, uint8_t){}
+int digitalRead(uint8_t){ return 0; }
+long random(long howbig){ return rng() % howbig; }
+long random(long howsmall, long howbig){ return howsmall + rng() % (howbig - howsmall); }
+
+// Serial.write() only blocks once the TX buffer is full
+size_t Print::write(const uint8_t * buffer, size_t size){
+    for(size_t i = 0; i < size; i++){
+        unsigned long long drained = (t_us - serial_drained_us) / SERIAL_BYTE_US;
+        if(drained >= serial_queued){
+            serial_queued = 0;
+            serial_drained_us = t_us;
+        } else {
+            serial_queued -= drained;
+            serial_drained_us += drained * SERIAL_BYTE_US;
+        }
+        if(serial_queued >= SERIAL_BUFFER){
+            advance(SERIAL_BYTE_US);
+            serial_queued--;
+            serial_drained_us += SERIAL_BYTE_US;
+        }
+        serial_queued++;
+    }
+    if(verbose)
+        fwrite(buffer, 1, size, stdout);
+    return size;
+}
+
+size_t Print::write(uint8_t c){ return write(&c, 1); }
+size_t Print::print(const char * s){ return write((const uint8_t *)s, strlen(s)); }
+size_t Print::print(const __FlashStringHelper * s){ return print((const char *)s); }
+size_t Print::print(char c){ return write((uint8_t)c); }
+size_t Print::print(int value, int base){ char s[20]; sprintf(s, base == HEX ? "%x" : "%d", value); return print(s); }
+size_t Print::print(unsigned value, int base){ char s[20]; sprintf(s, base == HEX ? "%x" : "%u", value); return print(s); }
+size_t Print::print(long value, int){ char s[24]; sprintf(s, "%ld", value); return print(s); }
+size_t Print::print(unsigned long value, int){ char s[24]; sprintf(s, "%lu", value); return print(s); }
+size_t Print::print(double value, int digits){ char s[32]; sprintf(s, "%.*f", digits, value); return print(s); }
+size_t Print::println(const char * s){ print(s); return println(); }
+size_t Print::println(const __FlashStringHelper * s){ print(s); return println(); }
+size_t Print::println(char c){ print(c); return println(); }
+size_t Print::println(int value, int base){ print(value, base); return println(); }
+size_t Print::println(unsigned value, int base){ print(value, base); return println(); }
+size_t Print::println(long value, int base){ print(value, base); return println(); }
+size_t Print::println(unsigned long value, int base){ print(value, base); return println(); }
+size_t Print::println(double value, int digits){ print(value, digits); return println(); }
+size_t Print::println(){ return print("\r\n"); }
+void HardwareSerial::begin(unsigned long){}
+int Stream::available(){ return 0; }
+int Stream::read(){ return -1; }
+
+// 100 kHz I2C: the address byte, then 9 bits per data byte
+void TwoWire::begin(){}
+void TwoWire::beginTransmission(uint8_t){ advance(I2C_BYTE_US + 10); }
+size_t TwoWire::write(uint8_t){ advance(I2C_BYTE_US); return 1; }
+uint8_t TwoWire::endTransmission(bool){ advance(10); return 0; }
+
+// RadioHead on node 0, following RadioHead 1.1x: the generic driver
+// calls, RHDatagram's header handling and RHReliableDatagram's blocking
+// sendtoWait()/recvfromAck(), for the BLOCKING_REPLY builds
+
+bool RHGenericDriver::init(){ return true; }
+
+RHGenericDriver::RHMode RHGenericDriver::mode(){
+    advance(2);
+    if(t_us < nodes[0].tx_until)
+        return RHModeTx;
+    return nodes[0].rx_on ? RHModeRx : RHModeIdle;
+}
+
+bool RHGenericDriver::available(){
+    advance(2);
+    node_t & node = nodes[0];
+    if(t_us < node.tx_until)
+        return false;
+    node.rx_on = true;
+    return node.rx_valid;
+}
+
+bool RHGenericDriver::waitPacketSent(){
+    if(t_us < nodes[0].tx_until)
+        advance(nodes[0].tx_until - t_us);
+    return true;
+}
+
+bool RHDatagram::init(){ return true; }
+bool RHDatagram::available(){ return _driver.available(); }
+bool RHDatagram::waitPacketSent(){ return _driver.waitPacketSent(); }
+
+bool RHDatagram::waitAvailableTimeout(uint16_t timeout){
+    unsigned long start = millis();
+    while(millis() - start < timeout)
+        if(available())
+            return true;
+    return false;
+}
+
+void RHDatagram::setHeaderId(uint8_t id){ nodes[0].header_id = id; }
+
+void RHDatagram::setHeaderFlags(uint8_t set, uint8_t clear){
+    nodes[0].header_flags = (nodes[0].header_flags & ~clear) | set;
+}
+
+bool RHDatagram::sendto(uint8_t * buf, uint8_t len, uint8_t address){
+    _driver.waitPacketSent();
+    transmit(0, address, buf, len);
+    return true;
+}
+
+bool RHDatagram::recvfrom(uint8_t * buf, uint8_t * len, uint8_t * from, uint8_t * to, uint8_t * id, uint8_t * flags){
+    if(!available())
+        return false;
+    node_t & node = nodes[0];
+    node.rx_valid = false;
+    if(buf && len){
+        if(*len > node.rx.len)
+            *len = node.rx.len;
+        memcpy(buf, node.rx.data, *len);
+    }
+    if(from) *from = node.rx.from;
+    if(to) *to = node.rx.to;
+    if(id) *id = node.rx.id;
+    if(flags) *flags = node.rx.flags;
+    return true;
+}
+
+void RHReliableDatagram::acknowledge(uint8_t id, uint8_t from){
+    setHeaderId(id);
+    setHeaderFlags(RH_FLAGS_ACK);
+    uint8_t ack = '!';
+    sendto(&ack, sizeof(ack), from);
+    waitPacketSent();
+}
+
+bool RHReliableDatagram::sendtoWait(uint8_t * buf, uint8_t len, uint8_t address){
+    uint8_t sequence = ++_lastSequenceNumber;
+    int retries = 0;
+    while(retries++ <= _retries){
+        setHeaderId(sequence);
+        setHeaderFlags(RH_FLAGS_NONE, RH_FLAGS_ACK);
+        sendto(buf, len, address);
+        waitPacketSent();
+        if(retries > 1)
+            _retransmissions++;
+        unsigned long sent = millis();
+        long timeout = _timeout + (_timeout * random(0, 256) / 256);
+        long left;
+        while((left = timeout - (long)(millis() - sent)) > 0){
+            if(!waitAvailableTimeout(left))
+                continue;
+            uint8_t from, to, id, flags;
+            if(!recvfrom(0, 0, &from, &to, &id, &flags))
+                continue;
+            if(from == address && to == _thisAddress && (flags & RH_FLAGS_ACK) && id == sequence)
+                return true;
+            if(!(flags & RH_FLAGS_ACK) && id == _seenIds[from])
+                acknowledge(id, from);
+        }
+    }
+    return false;
+}
+
+bool RHReliableDatagram::recvfromAck(uint8_t * buf, uint8_t * len, uint8_t * from, uint8_t * to, uint8_t * id, uint8_t * flags){
+    uint8_t _from, _to, _id, _flags;
+    if(!available() || !recvfrom(buf, len, &_from, &_to, &_id, &_flags))
+        return false;
+    if(_flags & RH_FLAGS_ACK)
+        return false;
+    if(_to == _thisAddress)
+        acknowledge(_id, _from);
+    if(_id == _seenIds[_from])
+        return false;
+    if(from) *from = _from;
+    if(to) *to = _to;
+    if(id) *id = _id;
+    if(flags) *flags = _flags;
+    _seenIds[_from] = _id;
+    return true;
+}
+
+int main(int argc, char ** argv){
+    if(argc < 4){
+        fprintf(stderr, "usage: %s <clients> <loss> <seed> [hours] [verbose]\n", argv[0]);
+        return 2;
+    }
+    int client_count = atoi(argv[1]);
+    loss = atof(argv[2]);
+    rng.seed(atoi(argv[3]));
+    double hours = argc > 4 ? atof(argv[4]) : 1.0;
+    verbose = argc > 5;
+    if(client_count < 1 || client_count > MAX_CLIENTS){
+        fprintf(stderr, "1 to %d clients\n", MAX_CLIENTS);
+        return 2;
+    }
+
+    node_t server = node_t();
+    server.address = SERVER_ADDRESS;
+    server.rx_on = true;
+    nodes.push_back(server);
+    const uint8_t addresses[MAX_CLIENTS] = { 1, 3, 5, 6, 7, 8, 9, 10 };
+    std::uniform_real_distribution<double> phase(0, READING_INTERVAL_MS);
+    std::uniform_real_distribution<double> drift(-0.005, 0.005);
+    for(int i = 0; i < client_count; i++){
+        node_t node = node_t();
+        node.address = addresses[i];
+        node.rx_on = true;
+        nodes.push_back(node);
+        client_t client = client_t();
+        client.node = i + 1;
+        client.state = CLIENT_IDLE;
+        client.next_reading_ms = phase(rng);
+        client.interval_ms = READING_INTERVAL_MS * (1 + drift(rng));
+        clients.push_back(client);
+    }
+
+    setup();
+    unsigned long long worst_us = 0;
+    while(t_us < hours * 3600e6){
+        unsigned long long start = t_us;
+        loop();
+        if(t_us - start > worst_us)
+            worst_us = t_us - start;
+    }
+
+    long readings = 0, sent = 0, gave_up = 0, superseded = 0, replies = 0;
+    for(auto & client : clients){
+        readings += client.readings;
+        sent += client.sent;
+        gave_up += client.gave_up;
+        superseded += client.superseded;
+        replies += client.replies;
+    }
+    printf("clients=%d loss=%.0f%% readings=%ld sent=%ld delivered=%d gave_up=%ld superseded=%ld "
+           "replies=%ld reply_fail=%d worst_pass=%llu ms\n",
+           client_count, loss * 100, readings, sent, recvcount, gave_up, superseded,
+           replies, failcount, worst_us / 1000);
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Just enough of the Arduino core to build the radio sketches and their
+// libraries on the host; the functions are defined by the simulator that
+// links them
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LED_BUILTIN 13
+#define HEX 16
+#define DEC 10
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) ((const __FlashStringHelper *)(s))
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define sprintf_P sprintf
+#define strlen_P strlen
+#define memcpy_P memcpy
+
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+// RX_PIN (D6) is PD6, PCINT22 in the PCINT2 group
+#define digitalPinToPCICR(p) (&PCICR)
+#define digitalPinToPCICRbit(p) (PCIE2)
+#define digitalPinToPCMSK(p) (&PCMSK2)
+#define digitalPinToPCMSKbit(p) (PCINT22)
+
+template<class T, class U> auto max(T a, U b) -> decltype(a + b){ return a > b ? a : b; }
+template<class T, class U> auto min(T a, U b) -> decltype(a + b){ return a < b ? a : b; }
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+class __FlashStringHelper;
+
+class Print
+{
+public:
+    size_t write(uint8_t c);
+    size_t write(const uint8_t * buffer, size_t size);
+    size_t print(const char * s);
+    size_t print(const __FlashStringHelper * s);
+    size_t print(char c);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+    size_t println(const char * s);
+    size_t println(const __FlashStringHelper * s);
+    size_t println(char c);
+    size_t println(int value, int base = DEC);
+    size_t println(unsigned value, int base = DEC);
+    size_t println(long value, int base = DEC);
+    size_t println(unsigned long value, int base = DEC);
+    size_t println(double value, int digits = 2);
+    size_t println();
+};
+
+class Stream : public Print
+{
+public:
+    int available();
+    int read();
+    int peek();
+    void flush();
+};
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud);
+};
+extern HardwareSerial Serial;
+
+void init();
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void pinMode(uint8_t pin, uint8_t mode);
+long random(long howbig);
+long random(long howsmall, long howbig);
@@ -0,0 +1,22 @@
+#pragma once
+#include <RHGenericDriver.h>
+
+class RHDatagram
+{
+public:
+    RHDatagram(RHGenericDriver & driver, uint8_t address = 0) : _driver(driver), _thisAddress(address){}
+    bool init();
+    bool sendto(uint8_t * buf, uint8_t len, uint8_t address);
+    bool recvfrom(uint8_t * buf, uint8_t * len, uint8_t * from = NULL, uint8_t * to = NULL,
+                  uint8_t * id = NULL, uint8_t * flags = NULL);
+    bool available();
+    bool waitPacketSent();
+    bool waitAvailableTimeout(uint16_t timeout);
+    void setHeaderId(uint8_t id);
+    void setHeaderFlags(uint8_t set, uint8_t clear = 0xff);
+    uint8_t thisAddress(){ return _thisAddress; }
+
+protected:
+    RHGenericDriver & _driver;
+    uint8_t _thisAddress;
+};
@@ -0,0 +1,15 @@
+#pragma once
+#include <Arduino.h>
+
+#define RH_FLAGS_NONE 0
+#define RH_BROADCAST_ADDRESS 0xff
+
+class RHGenericDriver
+{
+public:
+    typedef enum { RHModeInitialising = 0, RHModeSleep, RHModeIdle, RHModeTx, RHModeRx, RHModeCad } RHMode;
+    bool init();
+    bool available();
+    bool waitPacketSent();
+    RHMode mode();
+};
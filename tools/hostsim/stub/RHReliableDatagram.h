@@ -0,0 +1,27 @@
+#pragma once
+#include <RHDatagram.h>
+
+#define RH_FLAGS_ACK 0x80
+#define RH_FLAGS_RETRY 0x40
+
+class RHReliableDatagram : public RHDatagram
+{
+public:
+    RHReliableDatagram(RHGenericDriver & driver, uint8_t address = 0) : RHDatagram(driver, address){
+        memset(_seenIds, 0, sizeof(_seenIds));
+    }
+    void setTimeout(uint16_t timeout){ _timeout = timeout; }
+    void setRetries(uint8_t retries){ _retries = retries; }
+    bool sendtoWait(uint8_t * buf, uint8_t len, uint8_t address);
+    bool recvfromAck(uint8_t * buf, uint8_t * len, uint8_t * from = NULL, uint8_t * to = NULL,
+                     uint8_t * id = NULL, uint8_t * flags = NULL);
+    uint32_t retransmissions(){ return _retransmissions; }
+
+private:
+    void acknowledge(uint8_t id, uint8_t from);
+    uint16_t _timeout = 200;
+    uint8_t _retries = 3;
+    uint8_t _lastSequenceNumber = 0;
+    uint32_t _retransmissions = 0;
+    uint8_t _seenIds[256];
+};
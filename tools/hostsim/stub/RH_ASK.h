@@ -0,0 +1,10 @@
+#pragma once
+#include <RHGenericDriver.h>
+
+#define RH_ASK_MAX_MESSAGE_LEN 60
+
+class RH_ASK : public RHGenericDriver
+{
+public:
+    RH_ASK(uint16_t speed = 2000, uint8_t rxPin = 11, uint8_t txPin = 12, uint8_t pttPin = 10, bool pttInverted = false){}
+};
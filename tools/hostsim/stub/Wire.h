@@ -0,0 +1,12 @@
+#pragma once
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+    void begin();
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool stop = true);
+    size_t write(uint8_t data);
+};
+extern TwoWire Wire;
@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+uint8_t eeprom_read_byte(const uint8_t * address);
+void eeprom_update_byte(uint8_t * address, uint8_t value);
+void eeprom_read_block(void * dest, const void * source, size_t size);
+bool eeprom_is_ready();
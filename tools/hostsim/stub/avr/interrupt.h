@@ -0,0 +1,10 @@
+// Interrupts are off while the flag is set, and the simulator holds back
+// its timer and pin change interrupts until they are on again
+#pragma once
+#include <avr/io.h>
+
+inline bool & sim_interrupts_off(){ static bool off = false; return off; }
+
+#define ISR(vector) extern "C" void vector(void)
+#define cli() (sim_interrupts_off() = true)
+#define sei() (sim_interrupts_off() = false)
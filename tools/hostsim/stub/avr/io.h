@@ -0,0 +1,35 @@
+// The ATmega328P registers and bits main.cpp touches, as plain variables
+// the simulator defines and watches
+#pragma once
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define _BV(b) (1 << (b))
+#define RAMSTART 0x100
+#define E2END 1023
+
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B;
+extern volatile uint8_t TCCR2A, TCCR2B, TIMSK2, TIFR2, OCR2A, TCNT2;
+extern volatile uint8_t PCICR, PCMSK2, PCIFR, SREG, SMCR, MCUSR, PRR;
+
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define TOIE1 0
+#define TOV1 0
+#define OCIE1B 2
+#define OCF1B 2
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM21 1
+#define OCIE2A 1
+#define OCF2A 1
+#define PCIE2 2
+#define PCIF2 2
+#define PCINT22 6
+#define PRTIM1 3
@@ -0,0 +1,453 @@
+#!/usr/bin/env python3
+"""Simulates OOK sensor clients sharing one 480 bps RH_ASK channel.
+
+A stand-in for the radio: every frame takes its real RH_ASK airtime, any
+two frames that overlap are both lost (OOK has no capture effect), a node
+can't hear while it transmits, and each frame is also lost at random with
+probability --loss. Each client takes a reading every --interval ms, sends
+it if the last one is not still in flight, and the base station ACKs every
+data frame it hears, like RHReliableDatagram.
+
+The same seeded run is repeated for each retry policy and schedule:
+
+    fixed      RETRIES resends, TIMEOUT plus up to one TIMEOUT of jitter,
+               what the sketches did before lib/LinkAdapt
+    adaptive   lib/LinkAdapt, ported below with the same integer arithmetic
+    free       clients send as soon as they have a reading
+    slotted    lib/SlotSchedule (ENABLE_SLOTS): the base station beacons a
+               slot map and clients only start sending in their own slot,
+               timed by their own drifting clocks
+
+    linksim.py                                  # 4 clients, 10% loss, one hour
+    linksim.py --clients 8 --loss 0.3 --interval 5000
+"""
+
+import argparse
+import heapq
+import random
+
+DATARATE = 480
+PAYLOAD = 8                 # ardc_send_aht20: temperature and humidity floats
+ACK_PAYLOAD = 1
+TURNAROUND_MS = 5           # receive to ACK on the base station
+
+# ardc_send_aht20 settings
+RETRIES = 10
+TIMEOUT = 1000
+MIN_TIMEOUT = 400
+MAX_TIMEOUT = 4000
+
+# lib/LinkAdapt/LinkAdapt.h
+SUCCESS_START = 192
+SUCCESS_SHIFT = 3
+DEAD_LINK = 32
+DELIVERY_MISS = 3
+MAX_BACKOFF_SHIFT = 3
+MIN_RETRIES = 2
+
+# ENABLE_SLOTS settings in the sketches
+SLOT_COUNT = 5
+SLOT_MS = 2000
+BEACON_EVERY = 6
+
+# lib/SlotSchedule/SlotSchedule.h
+MAX_SLOTS = 8
+SLOT_HEADER = 7
+GUARD_MS = 40
+HEARTBEAT_MS = 300000
+EXPIRY_MS = 3 * HEARTBEAT_MS
+LOST_BEACONS = 3
+MAX_DRIFT_PERCENT = 2
+
+
+def frame_ms(length):
+    """RH_ASK airtime: preamble and start symbol, then two 6-bit symbols a byte."""
+    return ((length + 7) * 12 + 48) * 1000 // DATARATE
+
+
+class FixedPolicy:
+    name = "fixed"
+
+    def __init__(self, rng):
+        self.rng = rng
+
+    def timeout(self, attempt):
+        # RHReliableDatagram::sendtoWait()
+        return TIMEOUT + TIMEOUT * self.rng.randrange(256) // 256
+
+    def retries(self):
+        return RETRIES
+
+    def ack_received(self, rtt_ms, tries):
+        pass
+
+    def send_failed(self, tries):
+        pass
+
+
+class AdaptivePolicy:
+    """Port of lib/LinkAdapt."""
+    name = "adaptive"
+
+    def __init__(self, rng):
+        self.rng = rng
+        self.srtt8 = 0
+        self.rttvar4 = 0
+        self.have_rtt = False
+        self.success = SUCCESS_START
+
+    def attempt_result(self, acked):
+        if acked:
+            self.success += (256 - self.success) >> SUCCESS_SHIFT
+        else:
+            self.success -= (self.success + (1 << SUCCESS_SHIFT) - 1) >> SUCCESS_SHIFT
+
+    def ack_received(self, rtt_ms, tries):
+        for _ in range(1, tries):
+            self.attempt_result(False)
+        self.attempt_result(True)
+        if tries != 1:
+            return
+        rtt_ms = min(int(rtt_ms), MAX_TIMEOUT)
+        if not self.have_rtt:
+            self.srtt8 = rtt_ms << 3
+            self.rttvar4 = rtt_ms << 1
+            self.have_rtt = True
+            return
+        error = rtt_ms - (self.srtt8 >> 3)
+        self.srtt8 += error
+        self.rttvar4 += abs(error) - (self.rttvar4 >> 2)
+
+    def send_failed(self, tries):
+        for _ in range(tries):
+            self.attempt_result(False)
+
+    def rto(self):
+        if not self.have_rtt:
+            return TIMEOUT
+        return max(MIN_TIMEOUT, min(MAX_TIMEOUT, (self.srtt8 >> 3) + self.rttvar4))
+
+    def timeout(self, attempt):
+        base = self.rto() << min(attempt, MAX_BACKOFF_SHIFT)
+        jitter = (base >> 3) + ((base * (255 - self.success)) >> 8)
+        return min(base + self.rng.randint(0, jitter), 0xFFFF)
+
+    def retries(self):
+        if self.success < DEAD_LINK:
+            return 1
+        all_missed = 256
+        transmissions = 0
+        while all_missed > DELIVERY_MISS and transmissions <= RETRIES:
+            all_missed = (all_missed * (255 - self.success)) >> 8
+            transmissions += 1
+        return max(transmissions - 1, MIN_RETRIES)
+
+
+def tdiv(a, b):
+    """C integer division, truncating toward zero."""
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+class SlotMap:
+    """Port of lib/SlotSchedule SlotMap, on the base station's clock."""
+
+    def __init__(self, slots, slot_ms, beacon_every):
+        self.owners = [0] * slots
+        self.last_heard = [0] * slots
+        self.slot_ms = slot_ms
+        self.frame_ms = slots * slot_ms
+        self.beacon_every = beacon_every
+        self.frame_start = 0
+        self.frames_to_beacon = 0
+        self.beacon_sent = False
+
+    def advance(self, now):
+        while now - self.frame_start >= self.frame_ms:
+            self.frame_start += self.frame_ms
+            self.frames_to_beacon = (self.frames_to_beacon - 1 if self.frames_to_beacon
+                                     else self.beacon_every - 1)
+            self.beacon_sent = False
+
+    def beacon_due(self, now):
+        self.advance(now)
+        return (self.frames_to_beacon == 0 and not self.beacon_sent
+                and now - self.frame_start < self.slot_ms // 2)
+
+    def beacon(self, now):
+        self.advance(now)
+        self.beacon_sent = True
+        return (len(self.owners), self.beacon_every, self.slot_ms,
+                now - self.frame_start, list(self.owners))
+
+    def heard(self, address, now):
+        if address in self.owners[1:]:
+            slot = self.owners.index(address, 1)
+        else:
+            for slot in range(1, len(self.owners)):
+                if (self.owners[slot] == 0
+                        or now - self.last_heard[slot] > EXPIRY_MS):
+                    break
+            else:
+                return
+            self.owners[slot] = address
+        self.last_heard[slot] = now
+
+
+class SlotClock:
+    """Port of lib/SlotSchedule SlotClock, on a client's clock."""
+
+    def __init__(self, address):
+        self.address = address
+        self.slot = None
+        self.slots = 0
+        self.slot_ms = 0
+        self.beacon_every = 1
+        self.have_beacon = False
+        self.frame_start = 0
+        self.period16 = 0
+        self.nominal16 = 0
+        self.last_error = 0
+
+    def beacon(self, payload, rx_start):
+        slots, beacon_every, slot_ms, offset, owners = payload
+        start = rx_start - offset
+        nominal16 = slots * slot_ms * 16
+        if self.have_beacon and slots == self.slots and slot_ms == self.slot_ms:
+            elapsed = start - self.frame_start
+            frames = (elapsed * 16 + self.period16 // 2) // self.period16 if elapsed >= 0 else 0
+            if frames > 0:
+                self.last_error = start - (self.frame_start + frames * self.period16 // 16)
+                measured16 = elapsed * 16 // frames
+                if abs(measured16 - nominal16) <= nominal16 // 100 * MAX_DRIFT_PERCENT:
+                    self.period16 += tdiv(measured16 - self.period16, 4)
+        else:
+            self.period16 = nominal16
+            self.last_error = 0
+        self.nominal16 = nominal16
+        self.frame_start = start
+        self.slots = slots
+        self.slot_ms = slot_ms
+        self.beacon_every = beacon_every
+        self.slot = owners.index(self.address, 1) if self.address in owners[1:] else None
+        self.have_beacon = True
+
+    def synced(self, now):
+        return (self.have_beacon and self.slot is not None
+                and 0 <= now - self.frame_start < LOST_BEACONS * self.beacon_every * (self.period16 // 16))
+
+    def wait(self, now, need_ms):
+        if not self.synced(now):
+            return 0
+        position16 = ((now - self.frame_start) * 16) % self.period16
+        open16 = self.period16 * self.slot // self.slots + GUARD_MS * 16
+        close16 = self.period16 * (self.slot + 1) // self.slots
+        need16 = need_ms * 16
+        if open16 + need16 > close16:
+            return 0
+        if open16 <= position16 and position16 + need16 <= close16:
+            return 0
+        wait16 = open16 - position16 if position16 < open16 else self.period16 - position16 + open16
+        return (wait16 + 15) // 16
+
+
+class Client:
+    def __init__(self, address, policy, interval, phase):
+        self.address = address
+        self.policy = policy
+        self.interval = interval
+        self.clock = SlotClock(address)
+        self.clock_offset = int(phase * 1000)   # millis() at power up differs too
+        self.sending = False
+        self.id = 0
+        self.tries = 0
+        self.sent_time = 0
+        self.queued_time = 0
+        self.token = 0
+
+
+class Simulation:
+    def __init__(self, policy_class, slotted, args):
+        self.slotted = slotted
+        self.rng = random.Random(args.seed)
+        self.loss = args.loss
+        self.duration = args.duration * 1000
+        self.events = []
+        self.seq = 0
+        self.on_air = []            # [start, end, src, frame, collided]
+        self.busy_until = {}        # node -> end of its current transmission
+        self.server = 0
+        self.delivered = set()
+        self.interval_ms = args.interval
+        self.stats = dict(readings=0, delivered=0, acked=0, gave_up=0, superseded=0,
+                          frames=0, collisions=0, airtime_ms=0, latency_ms=0)
+        self.clients = []
+        for i in range(args.clients):
+            # ceramic resonators on the Nanos are good to about 0.5%
+            interval = args.interval * (1 + self.rng.uniform(-0.005, 0.005))
+            phase = self.rng.uniform(0, args.interval)
+            client = Client(i + 1, policy_class(random.Random(self.rng.random())), interval, phase)
+            self.clients.append(client)
+            self.schedule(phase, "sample", client)
+        if slotted:
+            self.slot_map = SlotMap(min(args.slots, MAX_SLOTS), SLOT_MS, BEACON_EVERY)
+            self.schedule(0, "beacon_check")
+
+    def schedule(self, time, kind, *data):
+        self.seq += 1
+        heapq.heappush(self.events, (time, self.seq, kind, data))
+
+    def transmit(self, now, src, frame, length):
+        end = now + frame_ms(length)
+        entry = [now, end, src, frame, False]
+        for other in self.on_air:
+            if other[1] > now:
+                if not other[4]:
+                    self.stats["collisions"] += 1
+                other[4] = True
+                if not entry[4]:
+                    self.stats["collisions"] += 1
+                entry[4] = True
+        self.on_air = [e for e in self.on_air if e[1] > now] + [entry]
+        self.busy_until[src] = end
+        if src != self.server:
+            self.stats["frames"] += 1
+            self.stats["airtime_ms"] += end - now
+        self.schedule(end, "tx_end", entry)
+
+    def heard_by(self, entry, node):
+        # a node transmitting during the frame can't hear it, but that
+        # overlap has already marked the frame as collided
+        return not entry[4] and self.rng.random() >= self.loss
+
+    def send_data(self, now, client):
+        client.token += 1
+        self.transmit(now, client.address, ("data", client.address, client.id, client.token), PAYLOAD)
+
+    def run(self):
+        while self.events:
+            now, _, kind, data = heapq.heappop(self.events)
+            if now > self.duration:
+                break
+            getattr(self, "on_" + kind)(now, *data)
+        return self.stats
+
+    def on_sample(self, now, client):
+        self.stats["readings"] += 1
+        self.schedule(now + client.interval, "sample", client)
+        if client.sending:
+            self.stats["superseded"] += 1
+            return
+        client.sending = True
+        client.id = (client.id + 1) & 0xFF
+        client.tries = 0
+        client.queued_time = now
+        self.send_attempt(now, client)
+
+    def local_ms(self, now, client):
+        # the client's millis(): its resonator runs as fast as its sample interval is short
+        return int(now * self.interval_ms / client.interval) + client.clock_offset
+
+    def send_attempt(self, now, client):
+        if self.slotted:
+            # our reading and its ACK, the simulated base station sends no reply
+            wait = client.clock.wait(self.local_ms(now, client),
+                                     frame_ms(PAYLOAD) + TURNAROUND_MS + frame_ms(ACK_PAYLOAD))
+            if wait:
+                self.schedule(now + (wait + 1) * client.interval / self.interval_ms,
+                              "slot_open", client, client.token)
+                return
+        client.timeout = client.policy.timeout(client.tries)
+        client.tries += 1
+        self.send_data(now, client)
+
+    def on_tx_end(self, now, entry):
+        kind, address, msg_id, token = entry[3]
+        if kind == "data":
+            client = self.clients[address - 1]
+            client.sent_time = now
+            self.schedule(now + client.timeout, "timeout", client, token)
+            if self.heard_by(entry, self.server):
+                if self.slotted:
+                    self.slot_map.heard(address, now)
+                if (address, msg_id, client.queued_time) not in self.delivered:
+                    self.delivered.add((address, msg_id, client.queued_time))
+                    self.stats["delivered"] += 1
+                self.schedule(now + TURNAROUND_MS, "base_ack", address, msg_id)
+        elif kind == "ack":
+            client = self.clients[address - 1]
+            if client.sending and msg_id == client.id and self.heard_by(entry, address):
+                client.policy.ack_received(now - client.sent_time, client.tries)
+                client.sending = False
+                client.token += 1       # cancels the pending timeout
+                self.stats["acked"] += 1
+                self.stats["latency_ms"] += now - client.queued_time
+        elif kind == "beacon":
+            for client in self.clients:
+                if self.heard_by(entry, client.address):
+                    client.clock.beacon(entry[3][1], self.local_ms(entry[0], client))
+
+    def on_beacon_check(self, now):
+        # beacons go out at the start of slot 0, after any ACK in progress
+        start = max(now, self.busy_until.get(self.server, 0))
+        if start > now:
+            self.schedule(start, "beacon_check")
+            return
+        if self.slot_map.beacon_due(now):
+            payload = self.slot_map.beacon(now)
+            self.transmit(now, self.server, ("beacon", payload, 0, 0), SLOT_HEADER + len(payload[4]))
+        self.slot_map.advance(now)
+        self.schedule(self.slot_map.frame_start + self.slot_map.frame_ms, "beacon_check")
+
+    def on_slot_open(self, now, client, token):
+        if token == client.token and client.sending:
+            self.send_attempt(now, client)
+
+    def on_base_ack(self, now, address, msg_id):
+        # the base station finishes any ACK it is already sending first
+        start = max(now, self.busy_until.get(self.server, 0))
+        if start > now:
+            self.schedule(start, "base_ack", address, msg_id)
+            return
+        self.transmit(now, self.server, ("ack", address, msg_id, 0), ACK_PAYLOAD)
+
+    def on_timeout(self, now, client, token):
+        if token != client.token or not client.sending:
+            return
+        if client.tries > client.policy.retries():
+            client.policy.send_failed(client.tries)
+            client.sending = False
+            self.stats["gave_up"] += 1
+            return
+        self.send_attempt(now, client)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--clients", type=int, default=4)
+    parser.add_argument("--loss", type=float, default=0.1, help="random frame loss, 0-1")
+    parser.add_argument("--interval", type=float, default=10000, help="ms between readings")
+    parser.add_argument("--duration", type=float, default=3600, help="simulated seconds")
+    parser.add_argument("--slots", type=int, default=SLOT_COUNT,
+                        help="slots per frame when slotted, slot 0 is the base station's")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    print("%d clients, %.0f%% frame loss, a reading every %d ms, %d s, data frame %d ms, ACK %d ms"
+          % (args.clients, args.loss * 100, args.interval, args.duration,
+             frame_ms(PAYLOAD), frame_ms(ACK_PAYLOAD)))
+    print("%-18s %8s %9s %8s %7s %7s %10s %9s %12s %10s" % (
+        "policy", "readings", "delivered", "acked", "gaveup", "frames", "collisions",
+        "airtime", "deliv/air-s", "latency"))
+    for policy_class, slotted in ((FixedPolicy, False), (AdaptivePolicy, False), (AdaptivePolicy, True)):
+        s = Simulation(policy_class, slotted, args).run()
+        airtime_s = s["airtime_ms"] / 1000.0
+        print("%-18s %8d %8.1f%% %8d %7d %7d %10d %8.0fs %12.3f %8.0fms" % (
+            policy_class.name + ("/slotted" if slotted else "/free"), s["readings"], 100.0 * s["delivered"] / max(s["readings"], 1),
+            s["acked"], s["gave_up"], s["frames"], s["collisions"], airtime_s,
+            s["delivered"] / max(airtime_s, 1e-9), s["latency_ms"] / max(s["acked"], 1)))
+
+
+if __name__ == "__main__":
+    main()
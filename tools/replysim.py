@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""Compare the receiver sketches' non-blocking replies with BLOCKING_REPLY.
+
+Builds ards_receive_display and ards_receive_aht20, unchanged, for the host
+with g++ against tools/hostsim (a stand-in for the Arduino core, Wire and
+RadioHead with simulated RH_ASK clients, see replysim.cpp), once as they
+are and once with -DBLOCKING_REPLY. Then runs each over a grid of client
+counts and frame loss rates, several seeds each, and prints the readings
+lost and the worst loop pass.
+
+    tools/replysim.py
+    tools/replysim.py --sketch ards_receive_display --clients 2 --loss 0.1 --seeds 1
+    tools/replysim.py --define ENABLE_SLOTS --builds non-blocking
+
+Like the Arduino builder, the .ino is given prototypes for its functions
+before the first definition, so it compiles as C++.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(TOOLS)
+HOSTSIM = os.path.join(TOOLS, "hostsim")
+BUILD_DIR = os.path.join(ROOT, "build", "replysim")
+
+SKETCHES = ("ards_receive_display", "ards_receive_aht20")
+BUILDS = {"non-blocking": [], "blocking": ["-DBLOCKING_REPLY"]}
+
+DEFINITION = re.compile(r"^[A-Za-z_][\w\s\*&<>:]*?[\s\*&](\w+)\s*\(([^;{}]*)\)\s*\{?\s*(//.*)?$")
+NOT_FUNCTIONS = {"if", "while", "for", "switch", "return", "sizeof"}
+RESULT = re.compile(r"(\w+)=([\d.]+)")
+# only included under ENABLE_CYCLE_BENCH, and needs the AVR's Timer1
+NOT_ON_HOST = {"CycleBench"}
+
+
+def strip_comments(line, in_block):
+    """Returns the code on a line, outside any /* */ comment, and whether
+    a block comment is still open at its end."""
+    code = ""
+    i = 0
+    while i < len(line):
+        if in_block:
+            end = line.find("*/", i)
+            if end < 0:
+                return code, True
+            i = end + 2
+            in_block = False
+        elif line.startswith("/*", i):
+            in_block = True
+            i += 2
+        elif line.startswith("//", i):
+            break
+        else:
+            code += line[i]
+            i += 1
+    return code, in_block
+
+
+def add_prototypes(source, name):
+    """The sketch with a prototype for every top-level function, each kept
+    inside the #if blocks around its definition."""
+    lines = source.splitlines()
+    prototypes = []
+    first = None
+    conditions = []     # one list of directives per open #if
+    depth = 0
+    in_block = False
+    for number, line in enumerate(lines):
+        code, in_block = strip_comments(line, in_block)
+        stripped = code.strip()
+        if stripped.startswith("#"):
+            directive = stripped[1:].split()[0] if len(stripped) > 1 else ""
+            if directive.startswith("if"):
+                conditions.append([stripped])
+            elif directive in ("else", "elif") and conditions:
+                conditions[-1].append(stripped)
+            elif directive == "endif" and conditions:
+                conditions.pop()
+            continue
+        if depth == 0:
+            match = DEFINITION.match(code.rstrip())
+            if match and match.group(1) not in NOT_FUNCTIONS:
+                following = code.rstrip().endswith("{") or any(
+                    l.strip().startswith("{") for l in lines[number + 1:number + 2])
+                if following:
+                    signature = code.split("{")[0].strip()
+                    prototypes.append((signature, [list(c) for c in conditions]))
+                    if first is None:
+                        first = number
+        depth += stripped.count("{") - stripped.count("}")
+
+    if first is None:
+        return source
+    header = []
+    for signature, blocks in prototypes:
+        for block in blocks:
+            header.extend(block)
+        header.append(signature + ";")
+        header.extend("#endif" for _ in blocks)
+    header.append('#line %d "%s"' % (first + 1, name))
+    return "\n".join(lines[:first] + header + lines[first:]) + "\n"
+
+
+def libraries(source):
+    """lib/ directories for the libraries a sketch includes."""
+    found = []
+    for name in re.findall(r"#include\s*<(\w+)\.h>", source):
+        path = os.path.join(ROOT, "lib", name)
+        if name not in NOT_ON_HOST and os.path.isdir(path) and path not in found:
+            found.append(path)
+    return found
+
+
+def build(sketch, build_name, flags):
+    ino = os.path.join(ROOT, "ook_radios", sketch, sketch + ".ino")
+    with open(ino) as f:
+        source = f.read()
+    if not os.path.isdir(BUILD_DIR):
+        os.makedirs(BUILD_DIR)
+    cpp = os.path.join(BUILD_DIR, sketch + ".ino.cpp")
+    with open(cpp, "w") as f:
+        f.write('#include <Arduino.h>\n#line 1 "%s"\n' % ino)
+        f.write(add_prototypes(source, ino))
+    libs = libraries(source)
+    out = os.path.join(BUILD_DIR, "%s_%s" % (sketch, build_name))
+    cmd = (["g++", "-O2", "-std=gnu++11", "-fpermissive", "-w", "-I", os.path.join(HOSTSIM, "stub")] +
+           [arg for lib in libs for arg in ("-I", lib)] + flags +
+           [cpp, os.path.join(HOSTSIM, "replysim.cpp")] +
+           [os.path.join(lib, f) for lib in libs for f in sorted(os.listdir(lib)) if f.endswith(".cpp")] +
+           ["-o", out])
+    if subprocess.call(cmd) != 0:
+        sys.exit("build of %s (%s) failed" % (sketch, build_name))
+    return out
+
+
+def run(binary, clients, loss, seeds, hours):
+    totals = {"readings": 0, "delivered": 0, "replies": 0, "reply_fail": 0}
+    worst = 0
+    for seed in range(1, seeds + 1):
+        output = subprocess.check_output([binary, str(clients), str(loss), str(seed), str(hours)],
+                                         universal_newlines=True)
+        values = dict(RESULT.findall(output))
+        for key in totals:
+            totals[key] += int(values[key])
+        worst = max(worst, int(values["worst_pass"]))
+    return totals, worst
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sketch", nargs="+", default=SKETCHES, choices=SKETCHES)
+    parser.add_argument("--builds", nargs="+", default=list(BUILDS), choices=list(BUILDS))
+    parser.add_argument("--clients", nargs="+", type=int, default=[1, 2, 4])
+    parser.add_argument("--loss", nargs="+", type=float, default=[0.0, 0.1, 0.3],
+                        help="chance each receiver misses a frame")
+    parser.add_argument("--seeds", type=int, default=5)
+    parser.add_argument("--hours", type=float, default=1.0, help="simulated time per run")
+    parser.add_argument("--define", nargs="*", default=[], help="extra sketch defines, e.g. ENABLE_SLOTS")
+    args = parser.parse_args()
+
+    extra = ["-D" + d for d in args.define]
+    print("%-22s %-13s %7s %5s %7s %11s %8s %10s" % ("sketch", "build", "clients", "loss", "lost",
+                                                     "worst pass", "replies", "reply fail"))
+    for sketch in args.sketch:
+        for build_name in args.builds:
+            binary = build(sketch, build_name, BUILDS[build_name] + extra)
+            for clients in args.clients:
+                for loss in args.loss:
+                    totals, worst = run(binary, clients, loss, args.seeds, args.hours)
+                    lost = 100.0 * (totals["readings"] - totals["delivered"]) / max(totals["readings"], 1)
+                    replies = 100.0 * totals["replies"] / max(totals["delivered"], 1)
+                    print("%-22s %-13s %7d %4.0f%% %6.1f%% %8d ms %7.1f%% %10d" % (
+                        sketch, build_name, clients, loss * 100, lost, worst, replies,
+                        totals["reply_fail"]))
+                    sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
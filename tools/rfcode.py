@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Builds authenticated trigger code words for the receiver's ENABLE_AUTH_CODES mode.
+
+A code word is the 32-bit counter and the first 4 bytes of its Chaskey-12
+MAC, little endian. It goes on air as a sync pulse of legit width, then one
+40 ms slot per bit, least significant bit of byte 0 first: 10 ms on for a 0,
+25 ms on for a 1. See lib/AuthCode for the board side.
+
+    rfcode.py 17                      # code word for counter 17
+    rfcode.py 17 --pulses             # plus the on/off schedule in ms
+    rfcode.py 17 --key 000102...0e0f  # key must match AUTH_KEY in src/main.cpp
+"""
+
+import argparse
+import struct
+
+DEFAULT_KEY = bytes(range(16))      # AUTH_KEY placeholder in src/main.cpp
+ROUNDS = 12
+SYNC_MS = 150
+SYNC_GAP_MS = 50
+SLOT_MS = 40
+BIT_MS = (10, 25)
+
+MASK = 0xFFFFFFFF
+
+
+def rotl(x, b):
+    return ((x << b) | (x >> (32 - b))) & MASK
+
+
+def permute(v, rounds=ROUNDS):
+    v0, v1, v2, v3 = v
+    for _ in range(rounds):
+        v0 = (v0 + v1) & MASK; v1 = rotl(v1, 5) ^ v0; v0 = rotl(v0, 16)
+        v2 = (v2 + v3) & MASK; v3 = rotl(v3, 8) ^ v2
+        v0 = (v0 + v3) & MASK; v3 = rotl(v3, 13) ^ v0
+        v2 = (v2 + v1) & MASK; v1 = rotl(v1, 7) ^ v2; v2 = rotl(v2, 16)
+    return [v0, v1, v2, v3]
+
+
+def times_two(k):
+    carry = 0x87 if k[3] >> 31 else 0
+    return [((k[0] << 1) & MASK) ^ carry,
+            ((k[1] << 1) & MASK) | (k[0] >> 31),
+            ((k[2] << 1) & MASK) | (k[1] >> 31),
+            ((k[3] << 1) & MASK) | (k[2] >> 31)]
+
+
+def chaskey(key, message):
+    """Chaskey-12 MAC of a message shorter than one block."""
+    if len(key) != 16 or len(message) >= 16:
+        raise ValueError("16 byte key and a single partial block only")
+    k = list(struct.unpack("<4I", key))
+    k2 = times_two(times_two(k))
+    block = struct.unpack("<4I", message + b"\x01" + bytes(15 - len(message)))
+    v = permute([k[i] ^ k2[i] ^ block[i] for i in range(4)])
+    return struct.pack("<4I", *[v[i] ^ k2[i] for i in range(4)])
+
+
+def code_word(key, counter):
+    message = struct.pack("<I", counter & MASK)
+    return message + chaskey(key, message)[:4]
+
+
+def pulse_schedule(code):
+    """(on_ms, off_ms) pairs, starting with the sync pulse."""
+    schedule = [(SYNC_MS, SYNC_GAP_MS)]
+    for i in range(len(code) * 8):
+        on = BIT_MS[(code[i // 8] >> (i % 8)) & 1]
+        schedule.append((on, SLOT_MS - on))
+    return schedule
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("counter", type=lambda s: int(s, 0))
+    parser.add_argument("--key", type=bytes.fromhex, default=DEFAULT_KEY,
+                        help="32 hex digits, default is the placeholder key")
+    parser.add_argument("--pulses", action="store_true", help="print the on/off schedule")
+    args = parser.parse_args()
+
+    if len(args.key) != 16:
+        parser.error("key must be 16 bytes")
+
+    code = code_word(args.key, args.counter)
+    print(code.hex())
+    if args.pulses:
+        for on, off in pulse_schedule(code):
+            print("%d %d" % (on, off))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Command line client for the receiver's binary protocol.
+
+    rfctl.py /dev/ttyUSB0 get
+    rfctl.py /dev/ttyUSB0 set filter_samples=7 min_legit_time_us=60000
+    rfctl.py /dev/ttyUSB0 stats
+    rfctl.py /dev/ttyUSB0 stream
+    rfctl.py /dev/ttyUSB0 log
+    rfctl.py /dev/ttyUSB0 text          # back to the single-key tuning menu
+
+Needs pyserial. The port can be a pseudo-terminal standing in for the board.
+"""
+
+import argparse
+import sys
+import time
+
+from rfproto import PARAMS, ProtocolError, Receiver
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=115200)
+    sub = parser.add_subparsers(dest="command")
+    get = sub.add_parser("get", help="read parameters (all by default)")
+    get.add_argument("names", nargs="*", help=", ".join(PARAMS))
+    put = sub.add_parser("set", help="write parameters atomically, name=value ...")
+    put.add_argument("assignments", nargs="+")
+    sub.add_parser("stats", help="receiver statistics snapshot")
+    stream = sub.add_parser("stream", help="print pulse events until Ctrl-C")
+    stream.add_argument("--text", action="store_true", help="keep the board's text output on")
+    sub.add_parser("log", help="dump the black-box event log")
+    sub.add_parser("text", help="return the board to text tuning commands")
+    args = parser.parse_args()
+
+    if not args.command:
+        parser.error("no command given")
+
+    try:
+        with Receiver(args.port, args.baud) as rx:
+            if args.command == "get":
+                for name in args.names:
+                    if name not in PARAMS:
+                        parser.error("unknown parameter %s" % name)
+                for name, value in rx.get_params(*args.names).items():
+                    print("%-20s %d" % (name, value))
+            elif args.command == "set":
+                values = {}
+                for assignment in args.assignments:
+                    name, _, value = assignment.partition("=")
+                    if name not in PARAMS or not value:
+                        parser.error("expected name=value with name one of %s" % ", ".join(PARAMS))
+                    values[name] = int(value, 0)
+                rx.set_params(**values)
+                print("ok")
+            elif args.command == "stats":
+                for name, value in rx.get_stats().items():
+                    print("%-20s %d" % (name, value))
+            elif args.command == "stream":
+                rx.configure(stream_pulses=True, text_output=args.text)
+                try:
+                    while True:
+                        for event in rx.poll_pulses():
+                            print("%8d us  %6d ms  %-9s  %d" % (event["width_us"],
+                                  event["interval_ms"], event["result"], event["pulse_count"]))
+                        time.sleep(0.01)
+                except KeyboardInterrupt:
+                    rx.configure()
+            elif args.command == "log":
+                for record in rx.dump_log():
+                    detail = ""
+                    if "width_us" in record:
+                        detail = "width %d ms" % (record["width_us"] // 1000)
+                    elif "count" in record:
+                        detail = "%d pulses" % record["count"]
+                    print("%12.3f s  %-18s %s" % (record["time_ms"] / 1000.0, record["type"], detail))
+            elif args.command == "text":
+                rx.configure(text_mode=True)
+    except ProtocolError as e:
+        sys.exit("error: %s" % e)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,270 @@
+"""Host side of the receiver's framed binary protocol.
+
+Frames are 00 <COBS(type, seq, body, crc16)> 00, with CRC-16/CCITT-FALSE
+little endian over type..body. See ENABLE_BINARY_PROTOCOL in src/main.cpp
+for the board side.
+
+    from rfproto import Receiver
+    with Receiver("/dev/ttyUSB0") as rx:
+        rx.set_params(filter_samples=7, min_legit_time_us=60000)
+        print(rx.get_stats())
+"""
+
+import struct
+import time
+
+MAX_PAYLOAD = 48    # FRAMED_SERIAL_MAX_PAYLOAD: type, seq and body
+
+MSG_GET = 0x01
+MSG_SET = 0x02
+MSG_GET_STATS = 0x03
+MSG_CONFIG = 0x04
+MSG_DUMP_LOG = 0x05
+
+MSG_ACK = 0x80
+MSG_VALUES = 0x81
+MSG_STATS = 0x82
+MSG_PULSE = 0x83
+MSG_LOG = 0x84
+
+ACK_STATUS = {0: "ok", 1: "bad length", 2: "unknown type", 3: "unknown param", 4: "bad value"}
+
+CONFIG_STREAM_PULSES = 0x01
+CONFIG_TEXT_OUTPUT = 0x02
+CONFIG_TEXT_MODE = 0x04
+
+PARAMS = {
+    "filter_samples": 1,
+    "min_stable_time_us": 2,
+    "debounce_time_us": 3,
+    "min_legit_time_us": 4,
+    "max_legit_time_us": 5,
+}
+PARAM_NAMES = {v: k for k, v in PARAMS.items()}
+
+PULSE_REJECTED = 0x80
+PULSE_RESULTS = {0: "ignored", 1: "started", 2: "restarted", 3: "advanced", 4: "activated",
+                 PULSE_REJECTED: "rejected"}
+
+LOG_TYPES = {0xF0: "boot", 0xF1: "time", 0x81: "rejects suppressed", 0x82: "deactivated",
+             0x83: "auth accepted", 0x84: "auth rejected", 0x85: "sequence expired"}
+LOG_TYPES.update(PULSE_RESULTS)
+LOG_WIDTH_SHIFT = 7
+
+STATS_FIELDS = ("valid_pulses", "rejected_pulses", "ignored_pulses", "sequence_resets",
+                "activations", "min_width_us", "max_width_us", "uptime_ms", "bad_frames",
+                "active_ms")
+STATS_FORMAT = "<8IHI"
+
+
+class ProtocolError(Exception):
+    pass
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos = 0
+    code = 1
+    for byte in data:
+        if byte == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(byte)
+            code += 1
+            if code == 0xFF:
+                out[code_pos] = code
+                code_pos = len(out)
+                out.append(0)
+                code = 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ProtocolError("bad COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(msg_type, seq, body=b""):
+    payload = bytes([msg_type, seq & 0xFF]) + bytes(body)
+    if len(payload) > MAX_PAYLOAD:
+        raise ProtocolError("body too long for the board")
+    return b"\x00" + cobs_encode(payload + struct.pack("<H", crc16(payload))) + b"\x00"
+
+
+def decode_frame(encoded):
+    """Returns (type, seq, body), raises ProtocolError on a bad frame."""
+    payload = cobs_decode(encoded)
+    if len(payload) < 4:
+        raise ProtocolError("short frame")
+    data, crc = payload[:-2], struct.unpack("<H", payload[-2:])[0]
+    if crc16(data) != crc:
+        raise ProtocolError("bad crc")
+    return data[0], data[1], data[2:]
+
+
+class FrameReader:
+    """Splits a byte stream on 00 delimiters, dropping anything that fails to decode
+    (including human-readable text the board printed before binary mode)."""
+
+    def __init__(self):
+        self._buffer = bytearray()
+        self.bad_frames = 0
+
+    def feed(self, data):
+        frames = []
+        for byte in data:
+            if byte != 0:
+                self._buffer.append(byte)
+                continue
+            if self._buffer:
+                try:
+                    frames.append(decode_frame(bytes(self._buffer)))
+                except ProtocolError:
+                    self.bad_frames += 1
+                self._buffer.clear()
+        return frames
+
+
+def parse_pulse(body):
+    width_us, interval_ms, result, count = struct.unpack("<IIBB", body)
+    return {"width_us": width_us, "interval_ms": interval_ms,
+            "result": PULSE_RESULTS.get(result, result), "pulse_count": count}
+
+
+class Receiver:
+    """Talks to the board (or any pseudo-terminal standing in for it)."""
+
+    def __init__(self, port, baudrate=115200, timeout=1.0, serial_port=None):
+        if serial_port is None:
+            import serial
+            serial_port = serial.Serial(port, baudrate, timeout=0.05)
+            # opening the port resets a Nano; give the bootloader time to hand over
+            time.sleep(2.0)
+        self._port = serial_port
+        self._reader = FrameReader()
+        self._pending = []
+        self._seq = 0
+        self.timeout = timeout
+        self.pulse_events = []
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        self._port.close()
+
+    def _read_frames(self):
+        data = self._port.read(max(1, self._port.in_waiting))
+        for frame in self._reader.feed(data):
+            if frame[0] == MSG_PULSE:
+                self.pulse_events.append(parse_pulse(frame[2]))
+            else:
+                self._pending.append(frame)
+
+    def request(self, msg_type, body=b""):
+        self._seq = (self._seq + 1) & 0xFF
+        seq = self._seq
+        self._port.write(encode_frame(msg_type, seq, body))
+        try:
+            return self._next_reply(seq)
+        except ProtocolError:
+            raise ProtocolError("no reply to message 0x%02x" % msg_type)
+
+    @staticmethod
+    def _check_ack(frame):
+        msg_type, _, body = frame
+        if msg_type != MSG_ACK:
+            raise ProtocolError("expected ACK, got 0x%02x" % msg_type)
+        if body[0] != 0:
+            param = PARAM_NAMES.get(body[1], body[1])
+            raise ProtocolError("%s (%s)" % (ACK_STATUS.get(body[0], body[0]), param))
+
+    def get_params(self, *names):
+        ids = [PARAMS[n] for n in (names or PARAMS)]
+        msg_type, _, body = self.request(MSG_GET, bytes(ids))
+        if msg_type == MSG_ACK:
+            self._check_ack((msg_type, 0, body))
+        return {PARAM_NAMES[body[i]]: struct.unpack("<I", body[i + 1:i + 5])[0]
+                for i in range(0, len(body), 5)}
+
+    def set_params(self, **values):
+        """All values are applied together or not at all."""
+        body = b"".join(struct.pack("<BI", PARAMS[k], v) for k, v in values.items())
+        self._check_ack(self.request(MSG_SET, body))
+
+    def get_stats(self):
+        msg_type, _, body = self.request(MSG_GET_STATS)
+        if msg_type != MSG_STATS:
+            raise ProtocolError("expected STATS, got 0x%02x" % msg_type)
+        return dict(zip(STATS_FIELDS, struct.unpack(STATS_FORMAT, body)))
+
+    def configure(self, stream_pulses=False, text_output=False, text_mode=False):
+        flags = ((CONFIG_STREAM_PULSES if stream_pulses else 0) |
+                 (CONFIG_TEXT_OUTPUT if text_output else 0) |
+                 (CONFIG_TEXT_MODE if text_mode else 0))
+        self._check_ack(self.request(MSG_CONFIG, bytes([flags])))
+
+    def dump_log(self):
+        """Event log records oldest first; time_ms restarts at every boot record."""
+        frame = self.request(MSG_DUMP_LOG)
+        records = []
+        while True:
+            msg_type, _, body = frame
+            if msg_type == MSG_ACK:
+                self._check_ack(frame)
+                return records
+            for i in range(0, len(body), 7):
+                kind, time_ms, value = struct.unpack("<BIH", body[i:i + 7])
+                record = {"type": LOG_TYPES.get(kind, kind), "time_ms": time_ms}
+                if kind in PULSE_RESULTS:
+                    record["width_us"] = value << LOG_WIDTH_SHIFT
+                elif kind == 0x81:
+                    record["count"] = value
+                elif kind == 0x83:
+                    record["counter"] = value
+                elif kind == 0x84:
+                    record["reason"], record["bits"] = value >> 8, value & 0xFF
+                elif kind == 0x85:
+                    record["pulses"] = value
+                records.append(record)
+            frame = self._next_reply(frame[1])
+
+    def _next_reply(self, seq):
+        deadline = time.monotonic() + self.timeout
+        while time.monotonic() < deadline:
+            self._read_frames()
+            for frame in self._pending:
+                if frame[1] == seq:
+                    self._pending.remove(frame)
+                    return frame
+        raise ProtocolError("reply stopped")
+
+    def poll_pulses(self):
+        self._read_frames()
+        events, self.pulse_events = self.pulse_events, []
+        return events
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""Checks the library ports in tools/linksim.py against the libraries.
+
+The vectors in tools/vectors/ are every call of a scripted run of the real
+library, built for the host by tools/hostsim/linkvectors.cpp, with its
+result. Each one is replayed on the port, which has to give the same
+results. Regenerate them after changing the library, then bring the port
+in line until this passes:
+
+    python tools/test_linksim.py
+    python tools/test_linksim.py --regenerate    # needs g++
+"""
+
+import os
+import re
+import subprocess
+import sys
+import unittest
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(TOOLS)
+VECTORS = os.path.join(TOOLS, "vectors")
+sys.path.insert(0, TOOLS)
+
+import linksim
+
+# vector set: libraries it is built from
+SETS = {"link_adapt": ["LinkAdapt"], "slot_schedule": ["SlotSchedule"]}
+
+
+def regenerate():
+    build_dir = os.path.join(ROOT, "build")
+    if not os.path.isdir(build_dir):
+        os.makedirs(build_dir)
+    binary = os.path.join(build_dir, "linkvectors")
+    libs = sorted(set(lib for names in SETS.values() for lib in names))
+    cmd = (["g++", "-O2", "-std=gnu++11", "-w", "-I", os.path.join(TOOLS, "hostsim", "stub")] +
+           [arg for lib in libs for arg in ("-I", os.path.join(ROOT, "lib", lib))] +
+           [os.path.join(TOOLS, "hostsim", "linkvectors.cpp")] +
+           [os.path.join(ROOT, "lib", lib, lib + ".cpp") for lib in libs] + ["-o", binary])
+    subprocess.check_call(cmd)
+    for name in SETS:
+        with open(os.path.join(VECTORS, name + ".txt"), "w") as f:
+            subprocess.check_call([binary, name], stdout=f)
+
+
+def read_vectors(name):
+    """(line number, call, [args], [results]) for each call in a vector set."""
+    calls = []
+    with open(os.path.join(VECTORS, name + ".txt")) as f:
+        for number, line in enumerate(f, 1):
+            if line.startswith("#") or not line.strip():
+                continue
+            words = line.split()
+            if "=" in words:
+                split = words.index("=")
+                calls.append((number, words[0], words[1:split], words[split + 1:]))
+            else:
+                calls.append((number, words[0], words[1:], []))
+    return calls
+
+
+def defines(path, prefix=""):
+    """The integer #defines in a header or sketch, without prefix."""
+    values = {}
+    with open(path) as f:
+        for name, value in re.findall(r"^#define\s+%s(\w+)\s+(\d+)U?L?\b" % prefix, f.read(), re.M):
+            values[name] = int(value)
+    return values
+
+
+class Draws:
+    """Stands in for the port's random.Random, returning the library's draws."""
+
+    def __init__(self, test):
+        self.test = test
+        self.bound = self.draw = None
+
+    def randint(self, low, high):
+        self.test.assertEqual((low, high + 1), (0, self.bound), "random() bound")
+        return self.draw
+
+
+class LinkAdaptPort(unittest.TestCase):
+    def test_constants(self):
+        header = defines(os.path.join(ROOT, "lib", "LinkAdapt", "LinkAdapt.h"), "LINK_ADAPT_")
+        for name in ("SUCCESS_START", "SUCCESS_SHIFT", "DEAD_LINK", "DELIVERY_MISS", "MIN_RETRIES",
+                     "MAX_BACKOFF_SHIFT"):
+            self.assertEqual(getattr(linksim, name), header[name], name)
+        sketch = defines(os.path.join(ROOT, "ook_radios", "ardc_send_aht20", "ardc_send_aht20.ino"))
+        for name in ("RETRIES", "TIMEOUT", "MIN_TIMEOUT", "MAX_TIMEOUT"):
+            self.assertEqual(getattr(linksim, name), sketch[name], name)
+
+    def test_vectors(self):
+        draws = Draws(self)
+        port = None
+        for number, call, args, results in read_vectors("link_adapt"):
+            if call == "scenario":
+                port = linksim.AdaptivePolicy(draws)
+                continue
+            args = [int(a) for a in args]
+            results = [int(r) for r in results]
+            with self.subTest(line=number):
+                if call == "timeout":
+                    attempt, draws.bound, draws.draw = args
+                    self.assertEqual(port.timeout(attempt), results[0])
+                    continue
+                if call == "ack":
+                    port.ack_received(*args)
+                else:
+                    port.send_failed(*args)
+                self.assertEqual([port.srtt8 >> 3, port.rttvar4 >> 2, port.success, port.rto(), port.retries()],
+                                 results)
+
+
+def beacon_bytes(payload):
+    """A port beacon tuple as the library's beacon payload."""
+    slots, beacon_every, slot_ms, offset, owners = payload
+    return bytes([ord("S"), slots, beacon_every, slot_ms & 0xff, slot_ms >> 8, offset & 0xff, offset >> 8] +
+                 owners)
+
+
+def beacon_tuple(data):
+    """The library's beacon payload as a port beacon tuple."""
+    slots = data[1]
+    return (slots, data[2], data[3] | data[4] << 8, data[5] | data[6] << 8, list(data[7:7 + slots]))
+
+
+class SlotSchedulePort(unittest.TestCase):
+    def test_constants(self):
+        header = defines(os.path.join(ROOT, "lib", "SlotSchedule", "SlotSchedule.h"), "SLOT_SCHEDULE_")
+        for name in ("MAX_SLOTS", "GUARD_MS", "HEARTBEAT_MS", "LOST_BEACONS", "MAX_DRIFT_PERCENT"):
+            self.assertEqual(getattr(linksim, name), header[name], name)
+        self.assertEqual(linksim.SLOT_HEADER, header["HEADER"], "HEADER")
+        for sketch in ("ards_receive_aht20", "ards_receive_display"):
+            values = defines(os.path.join(ROOT, "ook_radios", sketch, sketch + ".ino"))
+            for name in ("SLOT_COUNT", "SLOT_MS", "BEACON_EVERY"):
+                self.assertEqual(getattr(linksim, name), values[name], sketch + " " + name)
+
+    def test_vectors(self):
+        slot_map = slot_clock = None
+        for number, call, args, results in read_vectors("slot_schedule"):
+            with self.subTest(line=number):
+                if call == "airtime":
+                    self.assertEqual(linksim.frame_ms(int(args[0])), int(results[0]))
+                elif call == "map":
+                    slot_map = linksim.SlotMap(*[int(a) for a in args])
+                elif call == "heard":
+                    slot_map.heard(*[int(a) for a in args])
+                elif call == "due":
+                    self.assertEqual(slot_map.beacon_due(int(args[0])), bool(int(results[0])))
+                elif call == "beacon":
+                    self.assertEqual(beacon_bytes(slot_map.beacon(int(args[0]))).hex(), results[0])
+                elif call == "clock":
+                    slot_clock = linksim.SlotClock(int(args[0]))
+                elif call == "rx":
+                    self.assertEqual(results[0], "1", "library rejected the beacon")
+                    slot_clock.beacon(beacon_tuple(bytes.fromhex(args[0])), int(args[1]))
+                    slot = 255 if slot_clock.slot is None else slot_clock.slot
+                    drift = (linksim.tdiv((slot_clock.period16 - slot_clock.nominal16) * 15625,
+                                          slot_clock.nominal16 // 64) if slot_clock.nominal16 else 0)
+                    self.assertEqual([slot, slot_clock.last_error, drift], [int(r) for r in results[1:]])
+                elif call == "wait":
+                    now, need = int(args[0]), int(args[1])
+                    self.assertEqual([slot_clock.wait(now, need), int(slot_clock.synced(now))],
+                                     [int(r) for r in results])
+                else:
+                    self.fail("unknown call " + call)
+
+
+if __name__ == "__main__":
+    if "--regenerate" in sys.argv:
+        sys.argv.remove("--regenerate")
+        regenerate()
+    unittest.main()
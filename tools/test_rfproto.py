@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Checks the rfproto codec against frames produced by lib/FramedSerial.
+
+The FRAMES vectors are the bytes FramedSerial::send() wrote, built for the
+host with a Stream that captures its output; each one also decoded on
+that side. Re-capture them if the frame layout or the CRC changes.
+
+    python tools/test_rfproto.py
+"""
+
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+from rfproto import (MAX_PAYLOAD, FrameReader, ProtocolError, cobs_decode, cobs_encode,
+                     crc16, decode_frame, encode_frame)
+
+# name: (type, seq, body, wire bytes from FramedSerial::send)
+FRAMES = {
+    "empty body": (0x03, 0x00, b"", "000203035c4800"),
+    "embedded zeros": (0x02, 0x07, bytes.fromhex("0001000060ea0000"),
+                       "000302070201010360ea01035b0800"),
+    "zero body, 0xff seq": (0x80, 0xFF, b"\x00", "000380ff0339f400"),
+    "MAX_PAYLOAD, no zeros": (0x81, 0xFE, bytes(range(1, 47)),
+                              "003381fe" + bytes(range(1, 47)).hex() + "cadd00"),
+    "MAX_PAYLOAD, all zeros": (0x81, 0x00, bytes(46),
+                               "000281" + "01" * 46 + "03ce6b00"),
+}
+
+# the "embedded zeros" frame with the last CRC byte off by one; the
+# board counts it as a bad frame
+BAD_CRC = "000302070201010360ea01035b0900"
+
+
+class FirmwareFrames(unittest.TestCase):
+    def test_encode_matches_firmware(self):
+        for name, (msg_type, seq, body, wire) in FRAMES.items():
+            with self.subTest(name):
+                self.assertEqual(encode_frame(msg_type, seq, body).hex(), wire)
+
+    def test_decode_firmware_frames(self):
+        for name, (msg_type, seq, body, wire) in FRAMES.items():
+            with self.subTest(name):
+                encoded = bytes.fromhex(wire)
+                self.assertEqual(decode_frame(encoded[1:-1]), (msg_type, seq, body))
+
+    def test_bad_crc(self):
+        with self.assertRaises(ProtocolError):
+            decode_frame(bytes.fromhex(BAD_CRC)[1:-1])
+        reader = FrameReader()
+        self.assertEqual(reader.feed(bytes.fromhex(BAD_CRC)), [])
+        self.assertEqual(reader.bad_frames, 1)
+
+    def test_max_payload(self):
+        self.assertEqual(len(encode_frame(0x81, 0, bytes(MAX_PAYLOAD - 2))), 2 + MAX_PAYLOAD + 2 + 1)
+        # FramedSerial::send() refuses this and the board would drop it as an overflow
+        with self.assertRaises(ProtocolError):
+            encode_frame(0x81, 0, bytes(MAX_PAYLOAD - 1))
+
+    def test_short_frame(self):
+        with self.assertRaises(ProtocolError):
+            decode_frame(cobs_encode(b"\x03\x00"))
+
+    def test_reader_skips_text_and_empty_frames(self):
+        wire = b"Resetting Bounds\r\n" + b"\x00\x00" + bytes.fromhex(FRAMES["empty body"][3])
+        self.assertEqual(FrameReader().feed(wire), [(0x03, 0x00, b"")])
+
+
+class Codec(unittest.TestCase):
+    def test_crc_check_value(self):
+        # CRC-16/CCITT-FALSE
+        self.assertEqual(crc16(b"123456789"), 0x29B1)
+        self.assertEqual(crc16(b""), 0xFFFF)
+
+    def test_cobs_vectors(self):
+        vectors = [
+            (b"", "01"),
+            (b"\x00", "0101"),
+            (b"\x00\x00", "010101"),
+            (b"\x00\x11\x00", "01021101"),
+            (b"\x11\x22\x00\x33", "0311220233"),
+            (b"\x11\x00\x00\x00", "0211010101"),
+        ]
+        for data, encoded in vectors:
+            with self.subTest(data.hex()):
+                self.assertEqual(cobs_encode(data).hex(), encoded)
+                self.assertEqual(cobs_decode(bytes.fromhex(encoded)), data)
+
+    def test_cobs_254_byte_runs(self):
+        # longer than the board ever sends, but the block code wraps at 0xff
+        run = bytes(range(1, 255))
+        self.assertEqual(cobs_encode(run), b"\xff" + run + b"\x01")
+        self.assertEqual(cobs_decode(b"\xff" + run + b"\x01"), run)
+        self.assertEqual(cobs_decode(b"\xff" + run), run)
+        self.assertEqual(cobs_encode(run + b"\xff"), b"\xff" + run + b"\x02\xff")
+        self.assertEqual(cobs_decode(b"\xff" + run + b"\x02\xff"), run + b"\xff")
+        self.assertEqual(cobs_encode(b"\x00" + run), b"\x01\xff" + run + b"\x01")
+        self.assertEqual(cobs_decode(b"\x01\xff" + run + b"\x01"), b"\x00" + run)
+        for data in (run * 2, run + b"\x00" + run, bytes(300)):
+            self.assertEqual(cobs_decode(cobs_encode(data)), data)
+            self.assertNotIn(0, cobs_encode(data))
+
+    def test_cobs_rejects_truncated_block(self):
+        with self.assertRaises(ProtocolError):
+            cobs_decode(b"\x05\x11\x22")
+        with self.assertRaises(ProtocolError):
+            cobs_decode(b"\x02\x11\x00")
+
+
+if __name__ == "__main__":
+    unittest.main()